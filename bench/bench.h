@@ -0,0 +1,32 @@
+//
+// bench.h - helpers shared by the benchmarks
+//
+#ifndef CINDRA_BENCH_H
+#define CINDRA_BENCH_H
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include "../libs/frameWork/virtualMachine/output.h"
+
+namespace cid::bench {
+    // Formats like a real sink but discards the bytes
+    class NullSink final : public code::OutputSink {
+    protected:
+        void drain(const char*, size_t, const char*, size_t) override {}
+    };
+
+    // Fastest of `rounds` runs, in seconds
+    template<typename Run>
+    double best(const size_t rounds, Run run) {
+        double fastest = 1e300;
+        for (size_t r = 0; r < rounds; ++r) {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+            fastest = std::min(fastest, took.count());
+        }
+        return fastest;
+    }
+}
+
+#endif // CINDRA_BENCH_H
@@ -0,0 +1,56 @@
+//
+// code_size.cpp - bytes per instruction and decode speed of each CODE encoding
+// usage: code_size file.cd [file.cd ...]
+//
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../libs/frameWork/tokens/file.h"
+#include "../libs/frameWork/virtualMachine/code.h"
+#include "bench.h"
+
+using namespace std;
+using cid::bench::best;
+using cid::bench::NullSink;
+
+int main(int argc, const char** argv) {
+    if (argc < 2) {
+        cerr << "usage: code_size file.cd [file.cd ...]\n";
+        return 2;
+    }
+    vector<cid::help::SourceFile> sources;
+    for (int i = 1; i < argc; ++i) sources.push_back(cid::help::openFile(argv[i]));
+
+    const pair<const char*, cid::code::Encoding> encodings[] = {
+        {"bytes ", cid::code::Encoding::Bytes},
+        {"words ", cid::code::Encoding::Words},
+        {"varint", cid::code::Encoding::Varint},
+    };
+    NullSink out;
+    for (const auto& [name, encoding] : encodings) {
+        vector<cid::code::CODE> programs;
+        size_t bytes = 0, instructions = 0;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            auto code = cid::code::compile(sources[i].view(), encoding);
+            string err;
+            if (!cid::code::verify(code, &err)) {
+                cerr << argv[i + 1] << ": " << err << '\n';
+                return 1;
+            }
+            bytes += code.byteSize();
+            instructions += code.instructionCount();
+            programs.push_back(std::move(code));
+        }
+        const double indexed = best(5, [&] {
+            for (const auto& code : programs) cid::code::unsafeRunIndexed(code, out);
+        });
+        const double safe = best(5, [&] {
+            for (const auto& code : programs) cid::code::safeRun(code, out);
+        });
+        cout << name << ": " << bytes << " bytes, " << static_cast<double>(bytes) / instructions
+             << " bytes/instruction, indexed " << instructions / indexed / 1e6 << " M instr/s, safe "
+             << instructions / safe / 1e6 << " M instr/s\n";
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+//
+// dispatch.cpp - byte-indexed vs direct-threaded (plain and fused) unsafeRun, and the
+// byte-stream vs aligned-word encodings
+// usage: dispatch [instructions, default 10000000] [rounds, default 5]
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../libs/frameWork/virtualMachine/code.h"
+#include "bench.h"
+
+using namespace std;
+using cid::bench::best;
+using cid::bench::NullSink;
+
+int main(int argc, const char** argv) {
+    const size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+    const size_t rounds = argc > 2 ? strtoull(argv[2], nullptr, 10) : 5;
+
+    string src;
+    src.reserve(count * 12);
+    // tiny string operands keep the handlers cheap, so dispatch dominates
+    for (size_t i = 0; i < count; ++i) {
+        src += i % 2 ? "print \"\";\n" : "print \"ab\";\n";
+    }
+    src += "return 7;\n";
+
+    auto code = cid::code::compile(src);
+    auto words = cid::code::compile(src, cid::code::Encoding::Words);
+    string err;
+    if (!cid::code::verify(code, &err) || !cid::code::verify(words, &err)) {
+        cerr << err << '\n';
+        return 1;
+    }
+    NullSink out;
+    const double instructions = static_cast<double>(count + 1);
+
+    const double indexed = best(rounds, [&] { cid::code::unsafeRunIndexed(code, out); });
+    const double translate = best(rounds, [&] { cid::code::ThreadedCode t(code, cid::code::Fusion::None); });
+    const cid::code::ThreadedCode threaded(code, cid::code::Fusion::None);
+    const double run = best(rounds, [&] { threaded.run(code.getPool(), out); });
+    const double fuseTranslate = best(rounds, [&] { cid::code::ThreadedCode t(code); });
+    const cid::code::ThreadedCode fused(code);
+    const double fusedRun = best(rounds, [&] { fused.run(code.getPool(), out); });
+    const double wordIndexed = best(rounds, [&] { cid::code::unsafeRunIndexed(words, out); });
+    const double safeBytes = best(rounds, [&] { cid::code::safeRun(code, out); });
+    const double safeWords = best(rounds, [&] { cid::code::safeRun(words, out); });
+    const double wordTranslate = best(rounds, [&] { cid::code::ThreadedCode t(words, cid::code::Fusion::None); });
+
+    cout << count + 1 << " instructions, best of " << rounds << '\n'
+         << "byte-indexed: " << instructions / indexed / 1e6 << " M instr/s\n"
+         << "threaded:     " << instructions / run / 1e6 << " M instr/s (x" << indexed / run << ")\n"
+         << "translation:  " << translate * 1000 << " ms, "
+         << (threaded.size() * sizeof(cid::code::ThreadedCell)) / (1 << 20) << " MiB of cells\n"
+         << "fused:        " << instructions / fusedRun / 1e6 << " M instr/s (x" << indexed / fusedRun << "), "
+         << fused.size() << " cell(s)\n"
+         << "fusion:       " << fuseTranslate * 1000 << " ms, " << fused.blobSize() / 1024 << " KiB of blob\n"
+         << "encodings:    bytes " << code.getCode().size() / 1024 << " KiB, words "
+         << words.getWords().size() * sizeof(uint32_t) / 1024 << " KiB\n"
+         << "word-indexed: " << instructions / wordIndexed / 1e6 << " M instr/s (x" << indexed / wordIndexed << ")\n"
+         << "safe, bytes:  " << instructions / safeBytes / 1e6 << " M instr/s\n"
+         << "safe, words:  " << instructions / safeWords / 1e6 << " M instr/s (x" << safeBytes / safeWords << ")\n"
+         << "translation from words: " << wordTranslate * 1000 << " ms (x" << translate / wordTranslate << ")\n";
+    const int expect = cid::code::unsafeRunIndexed(code, out);
+    return expect == threaded.run(code.getPool(), out) && expect == fused.run(code.getPool(), out) && expect == cid::code::unsafeRunIndexed(words, out) &&
+           expect == cid::code::safeRun(words, out) ? 0 : 1;
+}
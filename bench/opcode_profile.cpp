@@ -0,0 +1,37 @@
+//
+// opcode_profile.cpp - opcode n-gram profile of a corpus of scripts
+// usage: opcode_profile file.cd [file.cd ...]
+//
+#include <iostream>
+#include <string>
+#include "../libs/frameWork/tokens/file.h"
+#include "../libs/frameWork/virtualMachine/profile.h"
+
+using namespace std;
+
+int main(int argc, const char** argv) {
+    if (argc < 2) {
+        cerr << "usage: opcode_profile file.cd [file.cd ...]\n";
+        return 2;
+    }
+    cid::code::OpcodeProfile profile;
+    for (int i = 1; i < argc; ++i) {
+        const auto source = cid::help::openFile(argv[i]);
+        auto code = cid::code::compile(source.view());
+        string err;
+        if (!cid::code::verify(code, &err)) {
+            cerr << argv[i] << ": " << err << '\n';
+            return 1;
+        }
+        profile.add(code);
+    }
+
+    cout << argc - 1 << " scripts, " << profile.total() << " instructions executed\n";
+    for (size_t n = 1; n <= cid::code::OpcodeProfile::MaxN; ++n) {
+        cout << n << "-grams:\n";
+        for (const auto& [ops, count] : profile.top(n, 5)) {
+            cout << "  " << 100.0 * count / profile.total() << "%  " << ops << " (" << count << ")\n";
+        }
+    }
+    return 0;
+}
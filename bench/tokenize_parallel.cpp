@@ -0,0 +1,69 @@
+//
+// tokenize_parallel.cpp - tokenizer scaling from 1 to N threads
+// usage: tokenize_parallel [MiB of generated source, default 256] [max threads, default all]
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../libs/frameWork/tokens/parallel.h"
+
+using namespace std;
+
+static string generate(const size_t bytes) {
+    string src;
+    src.reserve(bytes + 64);
+    for (size_t i = 0; src.size() < bytes; ++i) {
+        src += "print \"line ";
+        src += to_string(i);
+        src += "; // not a cut\";\n";
+        if (i % 7 == 0) src += "// comment; with a semicolon\n";
+        if (i % 11 == 0) src += "/* block;\n comment */ ";
+        src += "print ";
+        src += to_string(static_cast<int64_t>(i) - 500);
+        src += ";\n";
+    }
+    src += "return 0;\n";
+    return src;
+}
+
+static bool same(const cid::tok::TokenBuffer& a, const cid::tok::TokenBuffer& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a.type(i) != b.type(i) || a.offset(i) != b.offset(i) ||
+            a.lexeme(i).size() != b.lexeme(i).size() || a.literal(i) != b.literal(i)) return false;
+    }
+    return true;
+}
+
+int main(int argc, const char** argv) {
+    const size_t mib = argc > 1 ? strtoull(argv[1], nullptr, 10) : 256;
+    const string src = generate(mib << 20);
+    const size_t maxThreads = argc > 2 ? max<size_t>(strtoull(argv[2], nullptr, 10), 1)
+                                       : max(thread::hardware_concurrency(), 1u);
+
+    const auto reference = cid::tok::Tokenizer(src).tokenize();
+    cout << src.size() / (1 << 20) << " MiB, " << reference.size() << " tokens\n";
+
+    // powers of two up to maxThreads, then maxThreads itself
+    vector<size_t> counts;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) counts.push_back(threads);
+    if (counts.back() != maxThreads) counts.push_back(maxThreads);
+
+    double base = 0;
+    for (const size_t threads : counts) {
+        cid::conc::ThreadPool pool(threads);
+        const auto start = chrono::steady_clock::now();
+        const auto tokens = cid::tok::tokenizeParallel(src, pool, 1 << 16);
+        const chrono::duration<double> took = chrono::steady_clock::now() - start;
+        if (threads == 1) base = took.count();
+
+        cout << threads << " thread(s): " << took.count() * 1000 << " ms, "
+             << (src.size() / took.count()) / (1 << 20) << " MiB/s, x"
+             << base / took.count() << (same(tokens, reference) ? "" : "  OUTPUT DIFFERS") << '\n';
+        if (!same(tokens, reference)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+//
+// threadPool.h - fixed-size worker pool
+//
+#ifndef CINDRA_THREADPOOL_H
+#define CINDRA_THREADPOOL_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cid::conc {
+    class ThreadPool {
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> queue;
+        std::mutex lock;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        void work() {
+            for (;;) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [this] { return stopping || !queue.empty(); });
+                    if (queue.empty()) return; // stopping and drained
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                }
+                job();
+            }
+        }
+
+    public:
+        // 0 threads means one per hardware thread
+        explicit ThreadPool(size_t threads = 0) {
+            if (threads == 0) threads = std::thread::hardware_concurrency();
+            if (threads == 0) threads = 1;
+            workers.reserve(threads);
+            for (size_t i = 0; i < threads; ++i) {
+                workers.emplace_back([this] { work(); });
+            }
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Runs every job already queued, then joins
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& t : workers) t.join();
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return workers.size(); }
+
+        // Exceptions thrown by fn are delivered through the returned future
+        template<typename Fn>
+        auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+            using R = std::invoke_result_t<Fn>;
+            auto task = std::make_shared<std::packaged_task<R()>>(std::forward<Fn>(fn));
+            auto result = task->get_future();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                queue.emplace_back([task] { (*task)(); });
+            }
+            wake.notify_one();
+            return result;
+        }
+    };
+}
+
+#endif // CINDRA_THREADPOOL_H
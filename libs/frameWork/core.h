@@ -5,8 +5,14 @@
 #ifndef CINDRA_CORE_H
 #define CINDRA_CORE_H
 #include "tokens/tokenizer.h"
+#include "tokens/parallel.h"
 #include "tokens/file.h"
 #include "tokens/helper.h"
 #include "containers/unordered_dense_map.h"
+#include "memory/allocator.h"
 #include "virtualMachine/code.h"
+#include "virtualMachine/cdb.h"
+#include "virtualMachine/cache.h"
+#include "virtualMachine/batch.h"
+#include "virtualMachine/daemon.h"
 #endif //CINDRA_CORE_H
\ No newline at end of file
@@ -7,9 +7,13 @@
 #include <cstring>
 #include <new>
 #include <array>
+#include <functional>
+#include <stdexcept>
+#include <typeinfo>
 #include <string_view>
 //#include <expected>
 #include "dynamicBitSet.h"
+#include "../memory/heap.h"
 
 namespace lazy {
     using size_t = std::size_t;
@@ -125,7 +129,7 @@ namespace lazy {
                     if constexpr (!std::is_trivially_destructible_v<T>) {
                         static_cast<T*>(src)->~T();
                     }
-                    if (!isSBO) std::free(src);
+                    if (!isSBO) cid::mem::Pool::deallocate(src, sizeof(T), cid::mem::Tag::LazyAny);
                     return;
                 case S_B_O:
                     *static_cast<bool*>(dest) = isSBO;
@@ -175,7 +179,7 @@ namespace lazy {
             if (!metaData)
                 throw std::bad_alloc();
             constexpr bool isSBO = sizeof(T) <= SBO;
-            void* place = isSBO? static_cast<void*>(buffer) : ptr = malloc(sizeof(T));
+            void* place = isSBO? static_cast<void*>(buffer) : ptr = cid::mem::Pool::allocate(sizeof(T), cid::mem::Tag::LazyAny);
             place? new (place) T(o) : throw std::bad_alloc();
         }
         template<class T, typename... Args>
@@ -184,7 +188,7 @@ namespace lazy {
             if (!metaData)
                 throw std::bad_alloc();
             constexpr bool isSBO = sizeof(T) <= SBO;
-            void* place = isSBO? static_cast<void*>(buffer) : ptr = malloc(sizeof(T));
+            void* place = isSBO? static_cast<void*>(buffer) : ptr = cid::mem::Pool::allocate(sizeof(T), cid::mem::Tag::LazyAny);
             place? new (place) T(std::forward<Args>(args)...) : throw std::bad_alloc();
 
         }
@@ -194,7 +198,7 @@ namespace lazy {
                 throw std::bad_function_call();
             metaData = o.metaData;
             metaData(nullptr, detail::SIZEOF, &size, 0);
-            void* place = size < SBO? static_cast<void*>(buffer) : ptr = malloc(size);
+            void* place = size <= SBO? static_cast<void*>(buffer) : ptr = cid::mem::Pool::allocate(size, cid::mem::Tag::LazyAny);
             place? metaData(o.get(), detail::COPY,place, 0) : throw std::bad_alloc();
         }
         any(any&& o)  noexcept {
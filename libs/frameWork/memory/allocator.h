@@ -0,0 +1,128 @@
+//
+// allocator.h - standard allocator adaptors over the Arena and the Pool
+//
+#ifndef CINDRA_ALLOCATOR_H
+#define CINDRA_ALLOCATOR_H
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "heap.h"
+
+namespace cid::mem {
+    // Allocator over an Arena the caller keeps alive longer than every container using
+    // it. deallocate does nothing: a container's memory comes back when the arena is
+    // reset, so growth leaves its old buffers behind until then. Meant for containers
+    // built in one go and dropped together, like the data of one compilation.
+    template<typename T>
+    class ArenaAllocator {
+        template<typename U>
+        friend class ArenaAllocator;
+        Arena* arena;
+
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        explicit ArenaAllocator(Arena& arena) noexcept : arena(&arena) {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>& o) noexcept : arena(o.arena) {}
+
+        [[nodiscard]] T* allocate(const size_t n) {
+            if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T*, size_t) noexcept {}
+
+        [[nodiscard]] Arena& resource() const noexcept { return *arena; }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>& o) const noexcept { return arena == o.arena; }
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>& o) const noexcept { return arena != o.arena; }
+    };
+
+    // Stateless allocator over the Pool: small buffers come from the calling thread's
+    // magazines, large ones from malloc. Memory may be freed on any thread.
+    template<typename T>
+    class PoolAllocator {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "pool blocks are at most max-aligned");
+
+        // a class at least as large as the alignment is aligned to it
+        static size_t bytes(const size_t n) noexcept { return std::max(n * sizeof(T), alignof(T)); }
+
+    public:
+        using value_type = T;
+        using is_always_equal = std::true_type;
+
+        PoolAllocator() noexcept = default;
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+        [[nodiscard]] T* allocate(const size_t n) {
+            if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T*>(Pool::allocate(bytes(n)));
+        }
+        void deallocate(T* p, const size_t n) noexcept { Pool::deallocate(p, bytes(n)); }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+        template<typename U>
+        bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+    };
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    // The same two strategies as std::pmr resources, for code that picks its memory at
+    // run time: a std::pmr container (or ankerl::unordered_dense::pmr::map) takes either
+    // one without being a different type.
+
+    // Owns an Arena; see ArenaAllocator. Alignments above max_align_t are honoured.
+    class ArenaResource final : public std::pmr::memory_resource {
+        Arena own;
+
+        void* do_allocate(const size_t bytes, const size_t alignment) override {
+            return own.allocate(bytes, alignment);
+        }
+        void do_deallocate(void*, size_t, size_t) override {}
+        [[nodiscard]] bool do_is_equal(const memory_resource& o) const noexcept override { return this == &o; }
+
+    public:
+        explicit ArenaResource(const size_t blockSize = 64 * 1024, const PageOptions pages = {})
+            : own(blockSize, pages) {}
+
+        [[nodiscard]] Arena& arena() noexcept { return own; }
+        void reset() noexcept { own.reset(); }
+        void release() noexcept { own.release(); }
+    };
+
+    // Stateless; see PoolAllocator. Over-aligned requests go to operator new.
+    class PoolResource final : public std::pmr::memory_resource {
+        void* do_allocate(const size_t bytes, const size_t alignment) override {
+            if (alignment > alignof(std::max_align_t))
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            return Pool::allocate(std::max(bytes, alignment));
+        }
+        void do_deallocate(void* p, const size_t bytes, const size_t alignment) override {
+            if (alignment > alignof(std::max_align_t))
+                return std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            Pool::deallocate(p, std::max(bytes, alignment));
+        }
+        [[nodiscard]] bool do_is_equal(const memory_resource& o) const noexcept override {
+            return dynamic_cast<const PoolResource*>(&o) != nullptr;
+        }
+    };
+
+    // The one PoolResource of the process; never destroyed, like the Pool itself
+    inline PoolResource* poolResource() noexcept {
+        static auto* resource = new PoolResource;
+        return resource;
+    }
+}
+
+#endif // CINDRA_ALLOCATOR_H
@@ -4,39 +4,776 @@
 
 #ifndef CINDRA_HEAP_H
 #define CINDRA_HEAP_H
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
-#include <stdlib.h>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-constexpr size_t mBlockSIZE = 1024; //bytes
-constexpr size_t mBlockCount = 1024 * 16;
+#if defined(__unix__) || defined(__APPLE__)
+#define CINDRA_HAS_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
-inline struct Block {
-private:
-    void* memory;
-    bool isFree = false;
-    size_t offset = 0;
-    explicit Block(void* data): memory(data), isFree(data ? true:false) {}
-};
+namespace cid::mem {
+    // Subsystems memory is charged to. Code runs under the Tag of the innermost TagScope
+    // on its thread, Other outside any; the Pool takes its Tag from the caller.
+    enum class Tag : uint8_t { Other, Tokenizer, Parser, Codegen, VM, LazyAny };
+    inline constexpr size_t Tags = 6;
 
-inline struct MemoryManagement {
-private:
-    void** memory;
-    const size_t space = mBlockSIZE * mBlockCount;
-    Block allocated[1024];
-public:
-    MemoryManagement():
-    memory(static_cast<void**>(malloc(space))) {
-        for ( int i = 0; i < mBlockCount; i++ ) {}
-            allocated[i] = this->memory[i];
+    inline const char* tagName(const Tag tag) noexcept {
+        constexpr const char* names[Tags] = {"other", "tokenizer", "parser", "codegen", "vm", "lazy::any"};
+        return names[static_cast<size_t>(tag)];
     }
-}mManagement;
 
+    // Allocation accounting, compiled in with CINDRA_MEM_STATS and nothing but empty
+    // inline functions without it. Counted: Pool blocks, Arena blocks, and with
+    // memory/trackNew.h in the program every global operator new as well.
+#ifdef CINDRA_MEM_STATS
+    inline constexpr bool MemStatsEnabled = true;
+#else
+    inline constexpr bool MemStatsEnabled = false;
+#endif
 
+    struct UsageCounters {
+        uint64_t allocations = 0; // ever made
+        uint64_t bytesAllocated = 0; // ever made
+        uint64_t liveBytes = 0;
+        uint64_t peakBytes = 0; // high-water mark of liveBytes
+        uint64_t liveObjects = 0;
+    };
 
-inline void MemoRyAlloc(size_t size, size_t aligment = alignof(max_align_t)) {
+    // By size: the Pool's classes of 8 to 256 bytes, then everything larger
+    struct ClassCounters {
+        uint64_t allocations = 0;
+        uint64_t liveObjects = 0;
+        uint64_t peakObjects = 0;
+    };
 
+    struct MemoryStats {
+        static constexpr size_t Classes = 7;
+        UsageCounters total;
+        std::array<UsageCounters, Tags> tags{};
+        std::array<ClassCounters, Classes> classes{};
+
+        static constexpr size_t classOf(const size_t bytes) noexcept {
+            size_t c = 0;
+            while (c + 1 < Classes && (size_t{8} << c) < bytes) ++c;
+            return c;
+        }
+    };
+
+    namespace detail {
+        struct alignas(64) LiveUsage {
+            std::atomic<uint64_t> allocations{0}, bytes{0}, live{0}, peak{0}, objects{0};
+        };
+        struct alignas(64) LiveClass {
+            std::atomic<uint64_t> allocations{0}, live{0}, peak{0};
+        };
+        struct Accounting {
+            LiveUsage total;
+            LiveUsage tags[Tags];
+            LiveClass classes[MemoryStats::Classes];
+        };
+        inline Accounting accounting; // constant-initialized, never torn down
+
+        inline void raise(std::atomic<uint64_t>& peak, const uint64_t v) noexcept {
+            uint64_t seen = peak.load(std::memory_order_relaxed);
+            while (seen < v && !peak.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {}
+        }
+        inline void charge(LiveUsage& u, const size_t bytes) noexcept {
+            u.allocations.fetch_add(1, std::memory_order_relaxed);
+            u.bytes.fetch_add(bytes, std::memory_order_relaxed);
+            u.objects.fetch_add(1, std::memory_order_relaxed);
+            raise(u.peak, u.live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+        }
+        inline void credit(LiveUsage& u, const size_t bytes) noexcept {
+            u.objects.fetch_sub(1, std::memory_order_relaxed);
+            u.live.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+        inline UsageCounters snapshot(const LiveUsage& u) noexcept {
+            return {u.allocations.load(std::memory_order_relaxed), u.bytes.load(std::memory_order_relaxed),
+                    u.live.load(std::memory_order_relaxed), u.peak.load(std::memory_order_relaxed),
+                    u.objects.load(std::memory_order_relaxed)};
+        }
+
+#ifdef CINDRA_MEM_STATS
+        inline Tag& threadTag() noexcept {
+            thread_local Tag tag = Tag::Other;
+            return tag;
+        }
+#endif
+    }
+
+    inline Tag currentTag() noexcept {
+#ifdef CINDRA_MEM_STATS
+        return detail::threadTag();
+#else
+        return Tag::Other;
+#endif
+    }
+
+    // Charges what this thread allocates to tag until the scope ends
+    class TagScope {
+#ifdef CINDRA_MEM_STATS
+        Tag saved;
+
+    public:
+        explicit TagScope(const Tag tag) noexcept : saved(detail::threadTag()) { detail::threadTag() = tag; }
+        ~TagScope() { detail::threadTag() = saved; }
+#else
+    public:
+        explicit TagScope(Tag) noexcept {}
+#endif
+        TagScope(const TagScope&) = delete;
+        TagScope& operator=(const TagScope&) = delete;
+    };
+
+    // Hooks for allocators: every allocated() is matched by a released() of the same
+    // tag and size
+    inline void allocated(const Tag tag, const size_t bytes) noexcept {
+#ifdef CINDRA_MEM_STATS
+        auto& a = detail::accounting;
+        detail::charge(a.total, bytes);
+        detail::charge(a.tags[static_cast<size_t>(tag)], bytes);
+        auto& c = a.classes[MemoryStats::classOf(bytes)];
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        detail::raise(c.peak, c.live.fetch_add(1, std::memory_order_relaxed) + 1);
+#else
+        (void) tag;
+        (void) bytes;
+#endif
+    }
+
+    inline void released(const Tag tag, const size_t bytes) noexcept {
+#ifdef CINDRA_MEM_STATS
+        auto& a = detail::accounting;
+        detail::credit(a.total, bytes);
+        detail::credit(a.tags[static_cast<size_t>(tag)], bytes);
+        a.classes[MemoryStats::classOf(bytes)].live.fetch_sub(1, std::memory_order_relaxed);
+#else
+        (void) tag;
+        (void) bytes;
+#endif
+    }
+
+    // All zero when compiled out
+    inline MemoryStats memoryStats() noexcept {
+        MemoryStats s;
+        const auto& a = detail::accounting;
+        s.total = detail::snapshot(a.total);
+        for (size_t t = 0; t < Tags; ++t) s.tags[t] = detail::snapshot(a.tags[t]);
+        for (size_t c = 0; c < MemoryStats::Classes; ++c) {
+            s.classes[c] = {a.classes[c].allocations.load(std::memory_order_relaxed),
+                            a.classes[c].live.load(std::memory_order_relaxed),
+                            a.classes[c].peak.load(std::memory_order_relaxed)};
+        }
+        return s;
+    }
+
+    // Lowers every high-water mark to the current live value, to measure one phase
+    inline void resetPeaks() noexcept {
+        auto& a = detail::accounting;
+        auto lower = [](detail::LiveUsage& u) { u.peak.store(u.live.load(std::memory_order_relaxed), std::memory_order_relaxed); };
+        lower(a.total);
+        for (auto& t : a.tags) lower(t);
+        for (auto& c : a.classes) c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    inline void printMemoryStats(std::FILE* out, const MemoryStats& s = memoryStats()) {
+        if (!MemStatsEnabled) {
+            std::fputs("memory statistics are not compiled in (build with CINDRA_MEM_STATS)\n", out);
+            return;
+        }
+        auto row = [&](const char* name, const UsageCounters& u) {
+            std::fprintf(out, "%-10s %12llu %14llu %12llu %12llu %10llu\n", name,
+                         static_cast<unsigned long long>(u.allocations), static_cast<unsigned long long>(u.bytesAllocated),
+                         static_cast<unsigned long long>(u.liveBytes), static_cast<unsigned long long>(u.peakBytes),
+                         static_cast<unsigned long long>(u.liveObjects));
+        };
+        std::fprintf(out, "%-10s %12s %14s %12s %12s %10s\n", "tag", "allocs", "bytes", "live", "peak", "objects");
+        for (size_t t = 0; t < Tags; ++t) {
+            if (s.tags[t].allocations) row(tagName(static_cast<Tag>(t)), s.tags[t]);
+        }
+        row("total", s.total);
+        std::fprintf(out, "%-10s %12s %12s %12s\n", "size", "allocs", "live", "peak");
+        for (size_t c = 0; c < MemoryStats::Classes; ++c) {
+            char name[16];
+            if (c + 1 < MemoryStats::Classes) std::snprintf(name, sizeof(name), "<=%zu", size_t{8} << c);
+            else std::snprintf(name, sizeof(name), ">%zu", size_t{8} << (c - 1));
+            std::fprintf(out, "%-10s %12llu %12llu %12llu\n", name, static_cast<unsigned long long>(s.classes[c].allocations),
+                         static_cast<unsigned long long>(s.classes[c].liveObjects),
+                         static_cast<unsigned long long>(s.classes[c].peakObjects));
+        }
+    }
+
+    inline constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+    // Backing hints for large memory. hugePages asks for transparent huge pages
+    // (madvise(MADV_HUGEPAGE)), fewer TLB misses on big buffers. localNode places the
+    // pages on the NUMA node of the thread that first touches them, even under a
+    // process-wide interleave policy. Both are hints: where the system lacks them or
+    // refuses, the memory is plain pages and nothing fails.
+    struct PageOptions {
+        bool hugePages = false;
+        bool localNode = false;
+
+        [[nodiscard]] bool any() const noexcept { return hugePages || localNode; }
+
+        // CINDRA_HUGE_PAGES=1 and CINDRA_NUMA_LOCAL=1 turn them on
+        static PageOptions fromEnvironment() {
+            auto on = [](const char* name) {
+                const char* v = std::getenv(name);
+                return v && *v && *v != '0';
+            };
+            return {on("CINDRA_HUGE_PAGES"), on("CINDRA_NUMA_LOCAL")};
+        }
+    };
+
+    // The process default, read from the environment once
+    inline const PageOptions& defaultPageOptions() {
+        static const PageOptions options = PageOptions::fromEnvironment();
+        return options;
+    }
+
+    namespace detail {
+        inline size_t pageSize() noexcept {
+#ifdef CINDRA_HAS_MMAP
+            static const auto size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            return size;
+#else
+            return 4096;
+#endif
+        }
+
+        // [p, p + n) shrunk inward to multiples of alignment; false if nothing is left
+        inline bool innerRange(const void* p, const size_t n, const size_t alignment, char*& from, size_t& length) noexcept {
+            const auto at = reinterpret_cast<uintptr_t>(p);
+            const uintptr_t begin = (at + alignment - 1) & ~(alignment - 1);
+            const uintptr_t end = (at + n) & ~(alignment - 1);
+            if (end <= begin) return false;
+            from = reinterpret_cast<char*>(begin);
+            length = end - begin;
+            return true;
+        }
+
+        // Pages of the range are allocated on the node of the CPU that faults them in
+        inline void bindLocal(char* p, const size_t n) noexcept {
+#if defined(__linux__) && defined(SYS_mbind)
+            constexpr int MpolPreferred = 1; // with an empty node mask: the local node
+            ::syscall(SYS_mbind, p, n, MpolPreferred, nullptr, 0ul, 0u);
+#else
+            (void) p;
+            (void) n;
+#endif
+        }
+
+        inline void adviseHuge(char* p, const size_t n) noexcept {
+#if defined(CINDRA_HAS_MMAP) && defined(MADV_HUGEPAGE)
+            ::madvise(p, n, MADV_HUGEPAGE);
+#else
+            (void) p;
+            (void) n;
+#endif
+        }
+    }
+
+    // Anonymous pages for at least `bytes`, 2 MiB aligned when huge pages are asked
+    // for. With localNode the pages are touched here, so they land on this thread's
+    // node. Returns nullptr where mapping is unavailable or fails, and the caller falls
+    // back to malloc; otherwise `mapped` is the length to hand to unmapPages.
+    inline void* mapPages(const size_t bytes, const PageOptions options, size_t& mapped) noexcept {
+#ifdef CINDRA_HAS_MMAP
+        const size_t unit = options.hugePages ? HugePageSize : detail::pageSize();
+        if (bytes > static_cast<size_t>(-1) - 2 * unit) return nullptr;
+        const size_t length = (bytes + unit - 1) & ~(unit - 1);
+        // over-map by one unit and trim, for an aligned start
+        const size_t span = options.hugePages ? length + unit : length;
+        void* raw = ::mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        auto* p = static_cast<char*>(raw);
+        if (span != length) {
+            char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + unit - 1) & ~(unit - 1));
+            if (aligned != p) ::munmap(p, static_cast<size_t>(aligned - p));
+            if (char* tail = aligned + length; tail != p + span) ::munmap(tail, static_cast<size_t>(p + span - tail));
+            p = aligned;
+        }
+        if (options.hugePages) detail::adviseHuge(p, length);
+        if (options.localNode) {
+            detail::bindLocal(p, length);
+            const size_t step = detail::pageSize();
+            for (size_t i = 0; i < length; i += step) p[i] = 0;
+        }
+        mapped = length;
+        return p;
+#else
+        (void) bytes;
+        (void) options;
+        mapped = 0;
+        return nullptr;
+#endif
+    }
+
+    inline void unmapPages(void* p, const size_t mapped) noexcept {
+#ifdef CINDRA_HAS_MMAP
+        if (p) ::munmap(p, mapped);
+#else
+        (void) p;
+        (void) mapped;
+#endif
+    }
+
+    // Applies options to memory someone else allocated but has not filled yet, such as
+    // the storage of a freshly reserved vector: huge pages for its 2 MiB aligned
+    // interior, and a local-node policy for its whole pages, so they are placed on the
+    // node of the thread that fills them. Buffers under HugePageSize are left alone.
+    inline void adviseBuffer(const void* p, const size_t bytes, const PageOptions options = defaultPageOptions()) noexcept {
+        if (!options.any() || bytes < HugePageSize) return;
+        char* from;
+        size_t length;
+        if (options.hugePages && detail::innerRange(p, bytes, HugePageSize, from, length))
+            detail::adviseHuge(from, length);
+        if (options.localNode && detail::innerRange(p, bytes, detail::pageSize(), from, length))
+            detail::bindLocal(from, length);
+    }
+
+    template<typename T, typename A>
+    void adviseBuffer(const std::vector<T, A>& v, const PageOptions options = defaultPageOptions()) noexcept {
+        adviseBuffer(v.data(), v.capacity() * sizeof(T), options);
+    }
+
+    // Per-arena counters. Sizes are histogrammed by power of two: bucket i counts
+    // requests of (2^(i-1), 2^i] bytes, the last bucket everything larger.
+    struct ArenaStats {
+        static constexpr size_t Buckets = 24;
+        uint64_t allocations = 0;
+        uint64_t bytesRequested = 0; // sum of the sizes asked for
+        uint64_t bytesPadding = 0;   // lost to alignment
+        uint64_t bytesReserved = 0;  // held in blocks, used or not
+        uint64_t blocks = 0;
+        uint64_t largest = 0;
+        uint64_t resets = 0;
+        std::array<uint64_t, Buckets> sizes{};
+
+        static size_t bucket(const size_t n) {
+            size_t b = 0;
+            while (b + 1 < Buckets && (size_t{1} << b) < n) ++b;
+            return b;
+        }
+    };
+
+    // Bump-pointer arena over a chain of malloc'd blocks. Allocation is an align and a
+    // compare; nothing is freed one by one. reset() rewinds to the first block and keeps
+    // the chain for the next round, release() returns every block to the system.
+    // Requests larger than half a block get a dedicated block, dropped on reset.
+    // Destructors of objects placed in the arena never run, so make() only takes
+    // trivially destructible types. Not thread-safe: one arena per thread or per job.
+    // With PageOptions, blocks of half a huge page and up are mapped through mapPages
+    // and grow to fill the pages they were given.
+    class Arena {
+        struct alignas(std::max_align_t) Block {
+            Block* next;
+            size_t size;   // usable bytes after the header
+            size_t mapped; // length of the mapping, 0 when malloc'd
+            Tag tag;       // charged to, for the accounting
+            [[nodiscard]] char* data() noexcept { return reinterpret_cast<char*>(this + 1); }
+        };
+        static_assert(sizeof(Block) % alignof(std::max_align_t) == 0, "block payload stays max-aligned");
+
+        Block* first = nullptr;   // reusable chain, in order of use
+        Block* current = nullptr;
+        Block* large = nullptr;   // dedicated blocks of oversized requests
+        char* cursor = nullptr;
+        char* limit = nullptr;
+        size_t blockSize;
+        PageOptions pages;
+        ArenaStats counters;
+
+        Block* newBlock(const size_t size, Block* next) {
+            if (size > static_cast<size_t>(-1) - sizeof(Block)) throw std::bad_alloc();
+            Block* b = nullptr;
+            size_t mapped = 0;
+            if (pages.any() && sizeof(Block) + size >= HugePageSize / 2)
+                b = static_cast<Block*>(mapPages(sizeof(Block) + size, pages, mapped));
+            if (!b) {
+                b = static_cast<Block*>(std::malloc(sizeof(Block) + size));
+                if (!b) throw std::bad_alloc();
+                mapped = 0;
+            }
+            b->next = next;
+            b->size = mapped ? mapped - sizeof(Block) : size;
+            b->mapped = mapped;
+            b->tag = currentTag();
+            allocated(b->tag, sizeof(Block) + b->size);
+            counters.bytesReserved += b->size;
+            ++counters.blocks;
+            return b;
+        }
+        static void freeChain(Block* b) noexcept {
+            while (b) {
+                Block* next = b->next;
+                released(b->tag, sizeof(Block) + b->size);
+                if (b->mapped) unmapPages(b, b->mapped);
+                else std::free(b);
+                b = next;
+            }
+        }
+        void enter(Block* b) noexcept {
+            current = b;
+            cursor = b->data();
+            limit = cursor + b->size;
+        }
+
+        void* allocateSlow(const size_t size, const size_t alignment) {
+            if (size > static_cast<size_t>(-1) - (alignment - 1)) throw std::bad_alloc();
+            const size_t worst = size + alignment - 1;
+            if (worst > blockSize / 2) {
+                large = newBlock(worst, large);
+                return align(large->data(), alignment);
+            }
+            // the next block of the retained chain, else a fresh one linked after current
+            if (current && current->next) {
+                enter(current->next);
+            } else {
+                Block* b = newBlock(blockSize, nullptr);
+                if (current) current->next = b;
+                else first = b;
+                enter(b);
+            }
+            char* p = align(cursor, alignment);
+            counters.bytesPadding += static_cast<size_t>(p - cursor);
+            cursor = p + size;
+            return p;
+        }
+
+        static char* align(char* p, const size_t alignment) noexcept {
+            const auto at = reinterpret_cast<uintptr_t>(p);
+            return p + ((alignment - at % alignment) % alignment);
+        }
+
+    public:
+        explicit Arena(const size_t blockSize = 64 * 1024, const PageOptions pages = {})
+            : blockSize(blockSize < 256 ? 256 : blockSize), pages(pages) {}
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        Arena(Arena&& o) noexcept
+            : first(o.first), current(o.current), large(o.large), cursor(o.cursor), limit(o.limit),
+              blockSize(o.blockSize), pages(o.pages), counters(o.counters) {
+            o.first = o.current = o.large = nullptr;
+            o.cursor = o.limit = nullptr;
+            o.counters = {};
+        }
+        Arena& operator=(Arena&& o) noexcept {
+            if (this != &o) {
+                release();
+                first = o.first;
+                current = o.current;
+                large = o.large;
+                cursor = o.cursor;
+                limit = o.limit;
+                blockSize = o.blockSize;
+                pages = o.pages;
+                counters = o.counters;
+                o.first = o.current = o.large = nullptr;
+                o.cursor = o.limit = nullptr;
+                o.counters = {};
+            }
+            return *this;
+        }
+        ~Arena() { release(); }
+
+        // alignment must be a power of two
+        [[nodiscard]] void* allocate(const size_t size, const size_t alignment = alignof(std::max_align_t)) {
+            ++counters.allocations;
+            counters.bytesRequested += size;
+            ++counters.sizes[ArenaStats::bucket(size)];
+            if (size > counters.largest) counters.largest = size;
+
+            char* p = align(cursor, alignment);
+            if (cursor && p <= limit && size <= static_cast<size_t>(limit - p)) {
+                counters.bytesPadding += static_cast<size_t>(p - cursor);
+                cursor = p + size;
+                return p;
+            }
+            return allocateSlow(size, alignment);
+        }
+
+        template<typename T, typename... Args>
+        [[nodiscard]] T* make(Args&&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Uninitialized storage for n objects of T
+        template<typename T>
+        [[nodiscard]] T* allocateArray(const size_t n) {
+            static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+            if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+        }
+
+        // A copy of s that lives until the next reset
+        [[nodiscard]] std::string_view copy(const std::string_view s) {
+            if (s.empty()) return {};
+            char* p = allocateArray<char>(s.size());
+            std::memcpy(p, s.data(), s.size());
+            return {p, s.size()};
+        }
+
+        // Drops every allocation at once; the block chain is kept for reuse
+        void reset() noexcept {
+            freeChain(large);
+            large = nullptr;
+            counters.bytesReserved = 0;
+            counters.blocks = 0;
+            for (Block* b = first; b; b = b->next) {
+                counters.bytesReserved += b->size;
+                ++counters.blocks;
+            }
+            ++counters.resets;
+            if (first) enter(first);
+        }
+
+        // Drops every allocation and returns all memory
+        void release() noexcept {
+            freeChain(large);
+            freeChain(first);
+            first = current = large = nullptr;
+            cursor = limit = nullptr;
+            counters.bytesReserved = 0;
+            counters.blocks = 0;
+        }
+
+        [[nodiscard]] const ArenaStats& stats() const noexcept { return counters; }
+        [[nodiscard]] size_t bytesReserved() const noexcept { return counters.bytesReserved; }
+    };
+
+    // Fixed size classes of 8 to 256 bytes; anything larger goes straight to malloc.
+    // Each thread keeps two magazines (arrays of free blocks) per class and allocates
+    // and frees against them with no lock and no atomic. Only when both are empty on
+    // allocate, or both full on free, does it trade a whole magazine with the global
+    // depot, under that class's lock, so the lock is taken once per Capacity calls.
+    // A block may be freed on any thread; it joins that thread's magazine. Memory
+    // carved for the pool is kept for the life of the process.
+    // The caller passes the size (and Tag) back on deallocate, so blocks carry no header.
+    class Pool {
+    public:
+        static constexpr size_t Classes = 6;
+        static constexpr size_t MaxSize = 256;
+        static constexpr size_t Capacity = 64;         // blocks per magazine
+        static constexpr size_t SlabSize = 64 * 1024;  // carved into magazines on depot misses
+
+        static constexpr size_t classOf(const size_t size) noexcept {
+            size_t c = 0;
+            while ((size_t{8} << c) < size) ++c;
+            return c;
+        }
+        static constexpr size_t classSize(const size_t c) noexcept { return size_t{8} << c; }
+
+    private:
+        struct Magazine {
+            Magazine* next;
+            size_t count;
+            void* blocks[Capacity];
+        };
+
+        struct alignas(64) Depot {
+            std::mutex lock;
+            Magazine* full = nullptr;   // some may be partly filled by exiting threads
+            Magazine* empty = nullptr;
+            char* slab = nullptr;
+            char* slabEnd = nullptr;
+
+            // nullptr when out of memory
+            Magazine* takeEmpty() noexcept {
+                if (Magazine* m = empty) {
+                    empty = m->next;
+                    return m;
+                }
+                auto* m = static_cast<Magazine*>(std::malloc(sizeof(Magazine)));
+                if (m) m->count = 0;
+                return m;
+            }
+            // a magazine with at least one block, carving a new one if none is left
+            Magazine* takeFull(const size_t c) {
+                if (Magazine* m = full) {
+                    full = m->next;
+                    return m;
+                }
+                const size_t size = classSize(c);
+                Magazine* m = takeEmpty();
+                if (!m) throw std::bad_alloc();
+                while (m->count < Capacity) {
+                    if (static_cast<size_t>(slabEnd - slab) < size) {
+                        slab = static_cast<char*>(std::malloc(SlabSize));
+                        if (!slab) {
+                            slabEnd = nullptr;
+                            if (m->count) break;
+                            put(m);
+                            throw std::bad_alloc();
+                        }
+                        slabEnd = slab + SlabSize;
+                    }
+                    m->blocks[m->count++] = slab;
+                    slab += size;
+                }
+                return m;
+            }
+            void put(Magazine* m) noexcept {
+                Magazine*& list = m->count ? full : empty;
+                m->next = list;
+                list = m;
+            }
+        };
+
+        // Per class: `loaded` serves calls, `previous` is the spare swapped in before
+        // going to the depot
+        struct ThreadCache {
+            Magazine* loaded[Classes]{};
+            Magazine* previous[Classes]{};
+            bool retired = false;
+
+            ~ThreadCache() {
+                for (size_t c = 0; c < Classes; ++c) {
+                    const std::lock_guard<std::mutex> guard(depot(c).lock);
+                    if (loaded[c]) depot(c).put(loaded[c]);
+                    if (previous[c]) depot(c).put(previous[c]);
+                    loaded[c] = previous[c] = nullptr;
+                }
+                retired = true;
+            }
+        };
+
+        // Never destroyed, so blocks freed during static destruction still have a home
+        static Depot& depot(const size_t c) noexcept {
+            static auto* depots = new Depot[Classes];
+            return depots[c];
+        }
+        static ThreadCache& cache() noexcept {
+            thread_local ThreadCache local;
+            return local;
+        }
+
+        static void* refill(ThreadCache& tc, const size_t c) {
+            Depot& d = depot(c);
+            const std::lock_guard<std::mutex> guard(d.lock);
+            Magazine* fresh = d.takeFull(c);
+            if (tc.retired) {
+                // thread-local storage is gone: serve one block through the depot
+                void* p = fresh->blocks[--fresh->count];
+                d.put(fresh);
+                return p;
+            }
+            if (tc.previous[c]) d.put(tc.previous[c]);
+            tc.previous[c] = tc.loaded[c];
+            tc.loaded[c] = fresh;
+            return fresh->blocks[--fresh->count];
+        }
+
+        static void drain(ThreadCache& tc, const size_t c, void* p) noexcept {
+            Depot& d = depot(c);
+            const std::lock_guard<std::mutex> guard(d.lock);
+            if (tc.retired) {
+                // thread-local storage is gone: file the block with the depot
+                Magazine* m = d.full && d.full->count < Capacity ? d.full : d.takeEmpty();
+                if (!m) return; // nowhere to keep it; the block is leaked
+                const bool filed = m == d.full;
+                m->blocks[m->count++] = p;
+                if (!filed) d.put(m);
+                return;
+            }
+            Magazine* m = d.takeEmpty();
+            if (!m) return; // as above
+            if (tc.previous[c]) d.put(tc.previous[c]);
+            tc.previous[c] = tc.loaded[c];
+            tc.loaded[c] = m;
+            m->blocks[m->count++] = p;
+        }
+
+    public:
+        Pool() = delete;
+
+        // Aligned to alignof(std::max_align_t) from 16 bytes up, to 8 below
+        [[nodiscard]] static void* allocate(const size_t size, const Tag tag = Tag::Other) {
+            allocated(tag, size);
+            if (size > MaxSize) {
+                void* p = std::malloc(size);
+                if (!p) {
+                    released(tag, size);
+                    throw std::bad_alloc();
+                }
+                return p;
+            }
+            const size_t c = classOf(size);
+            ThreadCache& tc = cache();
+            if (Magazine* m = tc.loaded[c]; m && m->count) return m->blocks[--m->count];
+            if (Magazine* m = tc.previous[c]; m && m->count) {
+                tc.previous[c] = tc.loaded[c];
+                tc.loaded[c] = m;
+                return m->blocks[--m->count];
+            }
+            try {
+                return refill(tc, c);
+            } catch (...) {
+                released(tag, size);
+                throw;
+            }
+        }
+
+        // size and tag must be the ones p was allocated with
+        static void deallocate(void* p, const size_t size, const Tag tag = Tag::Other) noexcept {
+            if (!p) return;
+            released(tag, size);
+            if (size > MaxSize) {
+                std::free(p);
+                return;
+            }
+            const size_t c = classOf(size);
+            ThreadCache& tc = cache();
+            if (Magazine* m = tc.loaded[c]; m && m->count < Capacity) {
+                m->blocks[m->count++] = p;
+                return;
+            }
+            if (Magazine* m = tc.previous[c]; m && m->count < Capacity) {
+                tc.previous[c] = tc.loaded[c];
+                tc.loaded[c] = m;
+                m->blocks[m->count++] = p;
+                return;
+            }
+            drain(tc, c, p);
+        }
+
+        template<typename T, typename... Args>
+        [[nodiscard]] static T* make(Args&&... args) {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "pool blocks are at most max-aligned");
+            void* p = allocate(sizeof(T));
+            try {
+                return new (p) T(std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(p, sizeof(T));
+                throw;
+            }
+        }
+
+        template<typename T>
+        static void destroy(T* p) noexcept {
+            if (!p) return;
+            p->~T();
+            deallocate(p, sizeof(T));
+        }
+    };
 }
 
-#endif //CINDRA_HEAP_H
\ No newline at end of file
+#endif //CINDRA_HEAP_H
@@ -0,0 +1,76 @@
+//
+// trackNew.h - global operator new/delete that report to the heap.h accounting
+//
+// Include from exactly one translation unit of a program. Built with CINDRA_MEM_STATS,
+// every ordinary new and delete is charged to the current Tag, so std containers show
+// up per subsystem; without it this header defines nothing. Over-aligned new keeps the
+// library's own operators.
+//
+#ifndef CINDRA_TRACK_NEW_H
+#define CINDRA_TRACK_NEW_H
+#include "heap.h"
+
+#ifdef CINDRA_MEM_STATS
+#include <cstdlib>
+#include <new>
+
+namespace cid::mem::detail {
+    // In front of every tracked block: its size and tag, since delete may run under
+    // another tag and unsized
+    struct alignas(std::max_align_t) NewHeader {
+        size_t size;
+        Tag tag;
+    };
+
+    inline void* trackedNew(const size_t size) noexcept {
+        if (size > static_cast<size_t>(-1) - sizeof(NewHeader)) return nullptr; // new throws bad_alloc
+        auto* h = static_cast<NewHeader*>(std::malloc(sizeof(NewHeader) + size));
+        if (!h) return nullptr;
+        h->size = size;
+        h->tag = currentTag();
+        allocated(h->tag, size);
+        return h + 1;
+    }
+
+    inline void trackedDelete(void* p) noexcept {
+        if (!p) return;
+        auto* h = static_cast<NewHeader*>(p) - 1;
+        released(h->tag, h->size);
+        std::free(h);
+    }
+
+    inline void* trackedNewOrThrow(const size_t size) {
+        for (;;) {
+            if (void* p = trackedNew(size)) return p;
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+void* operator new(const std::size_t size) { return cid::mem::detail::trackedNewOrThrow(size); }
+void* operator new[](const std::size_t size) { return cid::mem::detail::trackedNewOrThrow(size); }
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return cid::mem::detail::trackedNewOrThrow(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return cid::mem::detail::trackedNewOrThrow(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void operator delete(void* p) noexcept { cid::mem::detail::trackedDelete(p); }
+void operator delete[](void* p) noexcept { cid::mem::detail::trackedDelete(p); }
+void operator delete(void* p, std::size_t) noexcept { cid::mem::detail::trackedDelete(p); }
+void operator delete[](void* p, std::size_t) noexcept { cid::mem::detail::trackedDelete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { cid::mem::detail::trackedDelete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { cid::mem::detail::trackedDelete(p); }
+#endif
+
+#endif // CINDRA_TRACK_NEW_H
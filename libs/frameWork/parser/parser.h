@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdint>
 #include "../tokens/token_type.h"
 #include "../tokens/tokenizer.h"
 
@@ -21,28 +22,34 @@ namespace cid::par {
     //         | ';'                      // permitido como no-op
     //   Program := { Stmt }
 
-    inline bool validateProgram(const std::vector<cid::tok::Token>& toks, std::string* err = nullptr) {
+    inline bool validateProgram(const cid::tok::TokenBuffer& toks, std::string* err = nullptr) {
+        const mem::TagScope scope(mem::Tag::Parser);
         auto setErr = [&](const std::string& m){ if (err) *err = m; };
+        const auto& types = toks.types();
         size_t i = 0;
-        auto atEnd = [&]{ return i >= toks.size(); };
-        auto peek = [&]() -> const cid::tok::Token& { return toks[i]; };
-        auto next = [&]() -> const cid::tok::Token& { return toks[i++]; };
+        auto atEnd = [&]{ return i >= types.size(); };
+        auto peek = [&] { return types[i]; };
+        auto next = [&] { return types[i++]; };
+        // bytecode int operands are 32-bit
+        auto fitsInt = [&](size_t at) {
+            const auto v = toks.literal(at);
+            return v >= INT32_MIN && v <= INT32_MAX;
+        };
         auto expect = [&](cid::tok::TokenType t, const char* msg) -> bool {
-            if (!atEnd() && peek().type == t) { next(); return true; }
+            if (!atEnd() && peek() == t) { next(); return true; }
             setErr(msg); return false;
         };
 
         while (!atEnd()) {
-            const auto& t = peek();
-            switch (t.type) {
+            switch (peek()) {
                 case cid::tok::PRINT: {
                     next();
                     if (atEnd()) { setErr("PRINT missing operand"); return false; }
-                    const auto& lit = next();
-                    if (lit.type == cid::tok::INT_LITERAL) {
-                        if (lit.data.size() != sizeof(int)) { setErr("INT literal size mismatch"); return false; }
+                    const auto lit = next();
+                    if (lit == cid::tok::INT_LITERAL) {
+                        if (!fitsInt(i - 1)) { setErr("INT literal out of range"); return false; }
                         if (!expect(cid::tok::SEMICOLON, "missing ';' after PRINT int")) return false;
-                    } else if (lit.type == cid::tok::STRING_LITERAL) {
+                    } else if (lit == cid::tok::STRING_LITERAL) {
                         if (!expect(cid::tok::SEMICOLON, "missing ';' after PRINT string")) return false;
                     } else {
                         setErr("PRINT expects literal"); return false;
@@ -52,10 +59,11 @@ namespace cid::par {
                 case cid::tok::RETURN: {
                     next();
                     if (atEnd()) { setErr("RETURN missing operand"); return false; }
-                    const auto& lit = next();
-                    if (lit.type != cid::tok::INT_LITERAL || lit.data.size() != sizeof(int)) {
+                    const auto lit = next();
+                    if (lit != cid::tok::INT_LITERAL) {
                         setErr("RETURN expects int literal"); return false;
                     }
+                    if (!fitsInt(i - 1)) { setErr("INT literal out of range"); return false; }
                     if (!expect(cid::tok::SEMICOLON, "missing ';' after RETURN")) return false;
                     break;
                 }
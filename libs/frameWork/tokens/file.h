@@ -4,15 +4,28 @@
 
 #ifndef CINDRA_FILE_H
 #define CINDRA_FILE_H
+#include <cerrno>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CINDRA_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using std::ifstream;
 namespace fs = std::filesystem;
 namespace cid::help {
     inline bool isValidExtension(const std::filesystem::path& path) {
-        static constexpr auto allow = {".cnd", ".cd", ".cindra"};
+        static constexpr auto allow = {".cnd", ".cd", ".cindra", ".cdb"};
         auto ext = path.extension().string();
         for (const auto& e : allow) {
             if (ext == e) return true;
@@ -20,7 +33,12 @@ namespace cid::help {
         return false;
     }
 
-    inline void extrFile(ifstream& file, string& buffer) {
+    // Precompiled bytecode images (see virtualMachine/cdb.h) rather than source
+    inline bool isBytecodeFile(const std::filesystem::path& path) {
+        return path.extension() == ".cdb";
+    }
+
+    inline void extrFile(ifstream& file, std::string& buffer) {
         file.seekg(0, std::ios::end);
         buffer.resize(file.tellg());
         file.seekg(0, std::ios::beg);
@@ -28,29 +46,136 @@ namespace cid::help {
         file.close();
     }
 
-    inline auto openFile(const int argc, const char** argv) {
-        if (argc <= 1) { // Corrigido para verificar argc <= 1
-            throw std::runtime_error("Wrong usage: you should pass a source file as program argument");
+    // Read-only source bytes. Regular files are mapped (startup cost is page faults, no
+    // copy); pipes, stdin and platforms without mmap fall back to an owned buffer.
+    class SourceFile {
+        std::string owned;
+        const char* mapped = nullptr;
+        size_t mappedSize = 0;
+
+        void release() noexcept {
+#ifdef CINDRA_HAS_MMAP
+            if (mapped) munmap(const_cast<char*>(mapped), mappedSize);
+#endif
+            mapped = nullptr;
+            mappedSize = 0;
         }
 
-        const fs::path src = argv[1]; // Agora seguro
+    public:
+        SourceFile() = default;
+        explicit SourceFile(std::string buffer) : owned(std::move(buffer)) {}
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+        SourceFile(SourceFile&& o) noexcept
+            : owned(std::move(o.owned)), mapped(o.mapped), mappedSize(o.mappedSize) {
+            o.mapped = nullptr;
+            o.mappedSize = 0;
+        }
+        SourceFile& operator=(SourceFile&& o) noexcept {
+            if (this != &o) {
+                release();
+                owned = std::move(o.owned);
+                mapped = o.mapped;
+                mappedSize = o.mappedSize;
+                o.mapped = nullptr;
+                o.mappedSize = 0;
+            }
+            return *this;
+        }
+        ~SourceFile() { release(); }
+
+        [[nodiscard]] std::string_view view() const noexcept {
+            return mapped ? std::string_view(mapped, mappedSize) : std::string_view(owned);
+        }
+        [[nodiscard]] bool isMapped() const noexcept { return mapped != nullptr; }
+
+#ifdef CINDRA_HAS_MMAP
+        // Buffered read of a descriptor that cannot be mapped (pipe, tty, stdin)
+        static SourceFile readAll(const int fd) {
+            std::string buffer;
+            size_t used = 0;
+            buffer.resize(64 * 1024);
+            for (;;) {
+                if (used == buffer.size()) buffer.resize(buffer.size() * 2);
+                const auto n = ::read(fd, &buffer[used], buffer.size() - used);
+                if (n == 0) break;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("File could not be read");
+                }
+                used += static_cast<size_t>(n);
+            }
+            buffer.resize(used);
+            return SourceFile(std::move(buffer));
+        }
+
+        static SourceFile map(const fs::path& src) {
+            const int fd = ::open(src.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("File could not be opened");
+            }
+            // closed on every path out, readAll throwing included; a mapping keeps
+            // its own reference
+            struct Closer {
+                int fd;
+                ~Closer() { ::close(fd); }
+            } closer{fd};
+            struct stat st{};
+            if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+                return readAll(fd);
+            }
+            const auto size = static_cast<size_t>(st.st_size);
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                return readAll(fd);
+            }
+            madvise(p, size, MADV_SEQUENTIAL);
+            SourceFile result;
+            result.mapped = static_cast<const char*>(p);
+            result.mappedSize = size;
+            return result;
+        }
+#else
+        static SourceFile map(const fs::path& src) {
+            ifstream file(src, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("File could not be opened");
+            }
+            std::string buffer;
+            extrFile(file, buffer);
+            return SourceFile(std::move(buffer));
+        }
+#endif
+    };
+
+    // "-" reads the program from stdin
+    inline SourceFile openFile(const fs::path& src) {
+        if (src == "-") {
+#ifdef CINDRA_HAS_MMAP
+            return SourceFile::readAll(STDIN_FILENO);
+#else
+            return SourceFile(std::string(std::istreambuf_iterator<char>(std::cin), {}));
+#endif
+        }
 
         if (!fs::exists(src)) {
             throw std::runtime_error("File does not exist");
         }
 
-        if (!isValidExtension(src)) {
+        // pipes and process substitutions (/dev/fd/N) carry no extension
+        if (fs::is_regular_file(src) && !isValidExtension(src)) {
             throw std::runtime_error("File is not a valid extension");
         }
 
-        ifstream file(src, std::ios::binary);
-        if (!file) {
-            throw std::runtime_error("File could not be opened");
+        return SourceFile::map(src);
+    }
+
+    inline SourceFile openFile(const int argc, const char** argv) {
+        if (argc <= 1) { // Corrigido para verificar argc <= 1
+            throw std::runtime_error("Wrong usage: you should pass a source file as program argument");
         }
 
-        string buffer;
-        extrFile(file, buffer);
-        return buffer;
+        return openFile(fs::path(argv[1])); // Agora seguro
     }
 }
-#endif //CINDRA_FILE_H
\ No newline at end of file
+#endif //CINDRA_FILE_H
@@ -128,8 +128,9 @@ namespace cid::help {
         }
     };
 
-    template<typename T>
-    bool readSafe(const std::vector<uint8_t>& code, size_t& i, T& out) {
+    // Bytes is any contiguous byte container with size() and operator[]
+    template<typename T, typename Bytes>
+    bool readSafe(const Bytes& code, size_t& i, T& out) {
         if (i + sizeof(T) > code.size()) return false;
         std::memcpy(&out, &code[i], sizeof(T));
         i += sizeof(T);
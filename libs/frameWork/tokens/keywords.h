@@ -0,0 +1,130 @@
+//
+// keywords.h - compile-time keyword classifier
+//
+#ifndef CINDRA_KEYWORDS_H
+#define CINDRA_KEYWORDS_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "token_type.h"
+
+namespace cid::tok {
+    struct KeywordEntry {
+        std::string_view text;
+        TokenType type;
+    };
+
+    // The single list of reserved words: the lookup table below is generated from it.
+    inline constexpr KeywordEntry keywordList[] = {
+        {"print", PRINT},
+        {"return", RETURN},
+    };
+
+    namespace detail {
+        constexpr size_t keywordCount = std::size(keywordList);
+
+        constexpr size_t keywordLength(const bool longest) {
+            size_t n = keywordList[0].text.size();
+            for (const auto& k : keywordList) {
+                n = longest ? (k.text.size() > n ? k.text.size() : n)
+                            : (k.text.size() < n ? k.text.size() : n);
+            }
+            return n;
+        }
+        constexpr size_t minKeywordLength = keywordLength(false);
+        constexpr size_t maxKeywordLength = keywordLength(true);
+
+        constexpr size_t tableSize() {
+            size_t n = 1;
+            while (n < keywordCount * 2) n <<= 1;
+            return n;
+        }
+        // The search may grow the table up to four times that
+        constexpr size_t keywordTableCapacity = tableSize() * 4;
+
+        // How much of a word keywordHash mixes: Sampled reads only length, first, middle
+        // and last byte, so long identifiers cost the same as short ones; Full reads every
+        // byte, for keyword sets that Sampled cannot tell apart under any seed.
+        enum class KeywordMix : uint8_t { Sampled, Full };
+
+        struct KeywordTable {
+            uint32_t seed = 0;
+            KeywordMix mix = KeywordMix::Sampled;
+            uint32_t mask = 0;
+            std::array<uint8_t, keywordTableCapacity> slots{}; // keywordList index + 1, 0 = empty
+        };
+
+        constexpr uint32_t keywordHash(const std::string_view s, const uint32_t seed, const KeywordMix mix,
+                                       const uint32_t mask) {
+            const auto byte = [&](const size_t i) { return static_cast<uint32_t>(static_cast<unsigned char>(s[i])); };
+            uint32_t h = static_cast<uint32_t>(s.size()) * 0x9E3779B1u;
+            if (mix == KeywordMix::Sampled) {
+                h ^= byte(0) | byte(s.size() / 2) << 8 | byte(s.size() - 1) << 16;
+            } else {
+                for (size_t i = 0; i < s.size(); ++i) h = (h ^ byte(i)) * 0x01000193u;
+            }
+            h *= seed * 2 + 1;
+            return (h ^ (h >> 15)) & mask;
+        }
+
+        // Two keywords Sampled cannot tell apart under any seed
+        constexpr bool sampledTwins() {
+            for (size_t i = 0; i < keywordCount; ++i) {
+                for (size_t j = i + 1; j < keywordCount; ++j) {
+                    const auto a = keywordList[i].text, b = keywordList[j].text;
+                    if (a.size() == b.size() && a[0] == b[0] && a[a.size() / 2] == b[b.size() / 2] &&
+                        a.back() == b.back())
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        // Cheapest mix, smallest table and first seed that give every keyword a slot of
+        // its own. The search runs at compile time, so a new keyword costs compile time,
+        // not a hand-picked constant.
+        constexpr KeywordTable buildKeywordTable() {
+            KeywordTable t{};
+            for (const auto mix : {KeywordMix::Sampled, KeywordMix::Full}) {
+                if (mix == KeywordMix::Sampled && sampledTwins()) continue;
+                for (size_t size = tableSize(); size <= keywordTableCapacity; size *= 2) {
+                    for (uint32_t seed = 1; seed < 1024; ++seed) {
+                        t.seed = seed;
+                        t.mix = mix;
+                        t.mask = static_cast<uint32_t>(size - 1);
+                        for (size_t i = 0; i < size; ++i) t.slots[i] = 0;
+                        bool ok = true;
+                        for (size_t i = 0; i < keywordCount && ok; ++i) {
+                            auto& slot = t.slots[keywordHash(keywordList[i].text, seed, mix, t.mask)];
+                            if (slot) ok = false;
+                            else slot = static_cast<uint8_t>(i + 1);
+                        }
+                        if (ok) return t;
+                    }
+                }
+            }
+            return {};
+        }
+        constexpr KeywordTable keywordTable = buildKeywordTable();
+        static_assert(keywordTable.seed != 0, "no collision-free seed for keywordList");
+        static_assert(keywordCount < 255, "keyword slots are stored as uint8_t");
+    }
+
+    // KEYWORD's TokenType for a reserved word, IDENTIFIER otherwise. No allocation,
+    // one table probe and at most one string compare.
+    constexpr TokenType classifyKeyword(const std::string_view s) {
+        using namespace detail;
+        if (s.size() < minKeywordLength || s.size() > maxKeywordLength) return IDENTIFIER;
+        const auto slot = keywordTable.slots[keywordHash(s, keywordTable.seed, keywordTable.mix, keywordTable.mask)];
+        if (slot == 0) return IDENTIFIER;
+        const auto& entry = keywordList[slot - 1];
+        return entry.text == s ? entry.type : IDENTIFIER;
+    }
+
+    static_assert(classifyKeyword("print") == PRINT);
+    static_assert(classifyKeyword("return") == RETURN);
+    static_assert(classifyKeyword("prints") == IDENTIFIER);
+}
+
+#endif // CINDRA_KEYWORDS_H
@@ -0,0 +1,120 @@
+//
+// number.h - allocation-free integer literal parsing
+//
+#ifndef CINDRA_NUMBER_H
+#define CINDRA_NUMBER_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "helper.h"
+
+namespace cid::help {
+    enum class ParseStatus : uint8_t {
+        Ok,
+        Overflow,  // does not fit in int64_t
+        Malformed, // bad digit for the base, dangling '_' or missing digits
+    };
+
+    struct IntLiteral {
+        int64_t value = 0;
+        size_t length = 0; // bytes consumed, including sign, prefix and separators
+        ParseStatus status = ParseStatus::Ok;
+    };
+
+    namespace detail {
+        constexpr int digitValue(const char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return 99;
+        }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // Eight ASCII decimal digits at p, or false. SWAR: one load, a range check on
+        // all lanes and three multiply/shift steps.
+        inline bool parseEightDigits(const char* p, uint64_t& out) {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            if (((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))
+                != 0x3333333333333333ull) {
+                return false;
+            }
+            v -= 0x3030303030303030ull;
+            v = v * 10 + (v >> 8);
+            v = ((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)) +
+                 ((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))) >> 32;
+            out = v;
+            return true;
+        }
+#else
+        inline bool parseEightDigits(const char*, uint64_t&) { return false; }
+#endif
+    }
+
+    // Parses [-](digits | 0x hex | 0b binary) starting at p, with '_' allowed between
+    // digits. Never throws and never allocates; the caller maps status to an error.
+    inline IntLiteral parseIntLiteral(const char* const begin, const char* const end) {
+        IntLiteral r;
+        const char* p = begin;
+        const bool negative = p < end && *p == '-';
+        if (negative) ++p;
+
+        uint32_t base = 10;
+        if (p + 1 < end && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            base = 16;
+            p += 2;
+        } else if (p + 1 < end && p[0] == '0' && (p[1] == 'b' || p[1] == 'B')) {
+            base = 2;
+            p += 2;
+        }
+
+        uint64_t magnitude = 0;
+        bool overflow = false, anyDigit = false, pendingSeparator = false;
+        while (p < end) {
+            if (base == 10 && !pendingSeparator && p + 8 <= end) {
+                uint64_t eight;
+                if (detail::parseEightDigits(p, eight)) {
+                    overflow |= __builtin_mul_overflow(magnitude, 100000000ull, &magnitude);
+                    overflow |= __builtin_add_overflow(magnitude, eight, &magnitude);
+                    anyDigit = true;
+                    p += 8;
+                    continue;
+                }
+            }
+            const char c = *p;
+            if (c == '_') {
+                if (!anyDigit || pendingSeparator) break;
+                pendingSeparator = true;
+                ++p;
+                continue;
+            }
+            const auto d = static_cast<uint32_t>(detail::digitValue(c));
+            if (d >= base) break;
+            overflow |= __builtin_mul_overflow(magnitude, base, &magnitude);
+            overflow |= __builtin_add_overflow(magnitude, d, &magnitude);
+            anyDigit = true;
+            pendingSeparator = false;
+            ++p;
+        }
+        r.length = static_cast<size_t>(p - begin);
+
+        // "12ab", "0b102", "1_" and a bare "0x" are one malformed literal, not two tokens
+        if (!anyDigit || pendingSeparator ||
+            (p < end && (isAlpha(*p) || isDigit(*p) || *p == '_'))) {
+            while (p < end && (isAlpha(*p) || isDigit(*p) || *p == '_')) ++p;
+            r.length = static_cast<size_t>(p - begin);
+            r.status = ParseStatus::Malformed;
+            return r;
+        }
+
+        const uint64_t limit = negative ? uint64_t{INT64_MAX} + 1 : uint64_t{INT64_MAX};
+        if (overflow || magnitude > limit) {
+            r.status = ParseStatus::Overflow;
+            return r;
+        }
+        r.value = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        return r;
+    }
+}
+
+#endif // CINDRA_NUMBER_H
@@ -0,0 +1,95 @@
+//
+// parallel.h - chunked multi-threaded tokenization
+//
+#ifndef CINDRA_PARALLEL_H
+#define CINDRA_PARALLEL_H
+#include <algorithm>
+#include <future>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "tokenizer.h"
+#include "scan.h"
+#include "../concurrency/threadPool.h"
+
+namespace cid::tok {
+    // Offsets that split src into at most `chunks` pieces, each cut falling just after a
+    // ';' or '\n' that is outside strings and comments. The pre-scan only tracks lexer
+    // state (no tokens are built), jumping over strings and comments with the scan
+    // kernels. Always starts with 0 and ends with src.size().
+    inline std::vector<size_t> chunkBoundaries(const std::string_view src, const size_t chunks) {
+        std::vector<size_t> cuts{0};
+        const char* const begin = src.data();
+        const char* const end = begin + src.size();
+        const size_t step = chunks > 1 ? src.size() / chunks : src.size() + 1;
+        size_t target = step;
+
+        const char* p = begin;
+        while (p < end && cuts.size() < chunks) {
+            const char c = *p++;
+            if (c == '"') {
+                p = help::scan::findByte(p, end, '"');
+                if (p < end) ++p;
+            } else if (c == '/' && p < end && *p == '/') {
+                p = help::scan::findByte(p, end, '\n');
+                if (p < end) ++p;
+                if (static_cast<size_t>(p - begin) >= target && p < end) {
+                    cuts.push_back(static_cast<size_t>(p - begin));
+                    target = cuts.back() + step;
+                }
+            } else if (c == '/' && p < end && *p == '*') {
+                p = help::scan::findPair(p + 1, end, '*', '/');
+                p = p < end ? p + 2 : end;
+            } else if ((c == ';' || c == '\n') && static_cast<size_t>(p - begin) >= target && p < end) {
+                cuts.push_back(static_cast<size_t>(p - begin));
+                target = cuts.back() + step;
+            }
+        }
+        cuts.push_back(src.size());
+        return cuts;
+    }
+
+    // Same TokenBuffer as Tokenizer(src).tokenize(), built on `pool`. Chunks are stitched
+    // in source order and offsets are absolute, so the output (and the first error
+    // reported) is identical whatever the thread count.
+    inline TokenBuffer tokenizeParallel(const std::string_view src, conc::ThreadPool& pool,
+                                        const size_t minChunk = 1 << 20) {
+        const mem::TagScope scope(mem::Tag::Tokenizer);
+        const size_t chunks = std::min(pool.size(), src.size() / std::max<size_t>(minChunk, 1));
+        if (chunks <= 1) return Tokenizer(src).tokenize();
+
+        const auto cuts = chunkBoundaries(src, chunks);
+        std::vector<std::future<TokenBuffer>> parts;
+        parts.reserve(cuts.size() - 1);
+        for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+            const size_t from = cuts[i], to = cuts[i + 1];
+            parts.push_back(pool.submit([src, from, to] { return Tokenizer(src, from, to).tokenize(); }));
+        }
+        for (auto& part : parts) part.wait(); // nothing may outlive src if a chunk throws
+
+        TokenBuffer out(src);
+        std::vector<TokenBuffer> done;
+        done.reserve(parts.size());
+        size_t total = 0;
+        for (auto& part : parts) {
+            done.push_back(part.get());
+            total += done.back().size();
+        }
+        out.reserve(total);
+        for (const auto& b : done) out.append(b);
+        return out;
+    }
+
+    // Sources below threads * minChunk bytes are tokenized inline without starting a pool
+    inline TokenBuffer tokenizeParallel(const std::string_view src, size_t threads = 0,
+                                        const size_t minChunk = 1 << 20) {
+        if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+        if (std::min(threads, src.size() / std::max<size_t>(minChunk, 1)) <= 1) {
+            return Tokenizer(src).tokenize();
+        }
+        conc::ThreadPool pool(threads);
+        return tokenizeParallel(src, pool, minChunk);
+    }
+}
+
+#endif // CINDRA_PARALLEL_H
@@ -0,0 +1,200 @@
+//
+// scan.h - vectorized byte scanning used by the tokenizer
+//
+// Every kernel has a scalar version plus SSE2 and AVX2 versions on x86; the widest
+// one the CPU supports is picked once, at first use.
+//
+#ifndef CINDRA_SCAN_H
+#define CINDRA_SCAN_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "helper.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CINDRA_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cid::help::scan {
+    namespace detail {
+        // ---- scalar -------------------------------------------------------------
+        inline const char* skipSpacesScalar(const char* p, const char* end) {
+            while (p < end && isSpace(*p)) ++p;
+            return p;
+        }
+        inline const char* findByteScalar(const char* p, const char* end, const char c) {
+            while (p < end && *p != c) ++p;
+            return p;
+        }
+        // first position of the pair "ab", or end
+        inline const char* findPairScalar(const char* p, const char* end, const char a, const char b) {
+            for (; p + 1 < end; ++p) {
+                if (p[0] == a && p[1] == b) return p;
+            }
+            return end;
+        }
+        inline size_t countByteScalar(const char* p, const char* end, const char c) {
+            size_t n = 0;
+            for (; p < end; ++p) n += *p == c;
+            return n;
+        }
+
+#ifdef CINDRA_SCAN_X86
+        // ---- SSE2 (16 bytes per step) -------------------------------------------
+        __attribute__((target("sse2")))
+        inline uint32_t spaceMask16(const __m128i v) {
+            const __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+            return static_cast<uint32_t>(_mm_movemask_epi8(m));
+        }
+        __attribute__((target("sse2")))
+        inline const char* skipSpacesSse2(const char* p, const char* end) {
+            for (; p + 16 <= end; p += 16) {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const uint32_t other = ~spaceMask16(v) & 0xFFFFu;
+                if (other) return p + __builtin_ctz(other);
+            }
+            return skipSpacesScalar(p, end);
+        }
+        __attribute__((target("sse2")))
+        inline const char* findByteSse2(const char* p, const char* end, const char c) {
+            const __m128i needle = _mm_set1_epi8(c);
+            for (; p + 16 <= end; p += 16) {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const auto m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+                if (m) return p + __builtin_ctz(m);
+            }
+            return findByteScalar(p, end, c);
+        }
+        __attribute__((target("sse2")))
+        inline const char* findPairSse2(const char* p, const char* end, const char a, const char b) {
+            const __m128i first = _mm_set1_epi8(a), second = _mm_set1_epi8(b);
+            for (; p + 17 <= end; p += 16) {
+                const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+                const auto m = static_cast<uint32_t>(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(v0, first), _mm_cmpeq_epi8(v1, second))));
+                if (m) return p + __builtin_ctz(m);
+            }
+            return findPairScalar(p, end, a, b);
+        }
+        __attribute__((target("sse2,popcnt")))
+        inline size_t countByteSse2(const char* p, const char* end, const char c) {
+            const __m128i needle = _mm_set1_epi8(c);
+            size_t n = 0;
+            for (; p + 16 <= end; p += 16) {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                n += __builtin_popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle))));
+            }
+            return n + countByteScalar(p, end, c);
+        }
+
+        // ---- AVX2 (32 bytes per step) -------------------------------------------
+        __attribute__((target("avx2")))
+        inline uint32_t spaceMask32(const __m256i v) {
+            const __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        }
+        __attribute__((target("avx2")))
+        inline const char* skipSpacesAvx2(const char* p, const char* end) {
+            for (; p + 32 <= end; p += 32) {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const uint32_t other = ~spaceMask32(v);
+                if (other) return p + __builtin_ctz(other);
+            }
+            return skipSpacesSse2(p, end);
+        }
+        __attribute__((target("avx2")))
+        inline const char* findByteAvx2(const char* p, const char* end, const char c) {
+            const __m256i needle = _mm256_set1_epi8(c);
+            for (; p + 32 <= end; p += 32) {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const auto m = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+                if (m) return p + __builtin_ctz(m);
+            }
+            return findByteSse2(p, end, c);
+        }
+        __attribute__((target("avx2")))
+        inline const char* findPairAvx2(const char* p, const char* end, const char a, const char b) {
+            const __m256i first = _mm256_set1_epi8(a), second = _mm256_set1_epi8(b);
+            for (; p + 33 <= end; p += 32) {
+                const auto v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const auto v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+                const auto m = static_cast<uint32_t>(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(v0, first), _mm256_cmpeq_epi8(v1, second))));
+                if (m) return p + __builtin_ctz(m);
+            }
+            return findPairSse2(p, end, a, b);
+        }
+        __attribute__((target("avx2,popcnt")))
+        inline size_t countByteAvx2(const char* p, const char* end, const char c) {
+            const __m256i needle = _mm256_set1_epi8(c);
+            size_t n = 0;
+            for (; p + 32 <= end; p += 32) {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                n += __builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle))));
+            }
+            return n + countByteScalar(p, end, c);
+        }
+#endif
+
+        struct Kernels {
+            const char* (*skipSpaces)(const char*, const char*);
+            const char* (*findByte)(const char*, const char*, char);
+            const char* (*findPair)(const char*, const char*, char, char);
+            size_t (*countByte)(const char*, const char*, char);
+        };
+
+        inline Kernels select() {
+#ifdef CINDRA_SCAN_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+                return {skipSpacesAvx2, findByteAvx2, findPairAvx2, countByteAvx2};
+            if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("popcnt"))
+                return {skipSpacesSse2, findByteSse2, findPairSse2, countByteSse2};
+#endif
+            return {skipSpacesScalar, findByteScalar, findPairScalar, countByteScalar};
+        }
+
+        inline const Kernels& kernels() {
+            static const Kernels k = select();
+            return k;
+        }
+    }
+
+    // First non-space byte in [p, end), or end. Single spaces are the common case,
+    // so the first byte is checked before paying for the indirect call.
+    inline const char* skipSpaces(const char* p, const char* end) {
+        if (p < end && !isSpace(*p)) return p;
+        return detail::kernels().skipSpaces(p, end);
+    }
+
+    inline const char* findByte(const char* p, const char* end, const char c) {
+        return detail::kernels().findByte(p, end, c);
+    }
+
+    // First occurrence of the two-byte sequence "ab" in [p, end), or end
+    inline const char* findPair(const char* p, const char* end, const char a, const char b) {
+        return detail::kernels().findPair(p, end, a, b);
+    }
+
+    inline size_t countNewlines(const char* p, const char* end) {
+        return detail::kernels().countByte(p, end, '\n');
+    }
+
+    // Appends base + (offset just past each '\n') in [p, end)
+    inline void newlineOffsets(const char* p, const char* end, std::vector<uint32_t>& out, uint32_t base = 0) {
+        out.reserve(out.size() + countNewlines(p, end));
+        const char* const begin = p;
+        while ((p = findByte(p, end, '\n')) < end) {
+            ++p;
+            out.push_back(base + static_cast<uint32_t>(p - begin));
+        }
+    }
+}
+
+#endif // CINDRA_SCAN_H
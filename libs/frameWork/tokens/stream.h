@@ -0,0 +1,281 @@
+//
+// stream.h - pull-based tokenizer over a bounded input window
+//
+#ifndef CINDRA_STREAM_H
+#define CINDRA_STREAM_H
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include "token_type.h"
+#include "token_buffer.h"
+#include "scan.h"
+#include "keywords.h"
+#include "number.h"
+#include "helper.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cid::tok {
+    // Same lexical rules and errors as Tokenizer, but the source is read from a
+    // descriptor `window` bytes at a time and tokens are produced one per next() call,
+    // so memory stays O(window) whatever the input size. Comments and whitespace may
+    // span any number of refills; a single string or literal must fit in the window.
+    // A token's lexeme points into the window and is only valid until the next call.
+    class TokenStream {
+        std::unique_ptr<char[]> buf;
+        size_t capacity;
+        size_t head = 0;  // first unconsumed byte
+        size_t tail = 0;  // one past the last byte read
+        size_t base = 0;  // source offset of buf[0]
+        size_t line = 1;
+        size_t lineStart = 0; // source offset of the current line
+        std::pair<size_t, size_t> started{1, 1}; // where next() began the current token or comment
+        int fd;
+        bool ownsFd;
+        bool eof = false;
+
+        [[nodiscard]] const char* at() const noexcept { return buf.get() + head; }
+        [[nodiscard]] const char* filled() const noexcept { return buf.get() + tail; }
+
+        // Consumes up to p, keeping line/column bookkeeping for the skipped bytes
+        void seek(const char* p) {
+            for (const char* q = at(); (q = help::scan::findByte(q, p, '\n')) < p; ++q) {
+                ++line;
+                lineStart = base + static_cast<size_t>(q + 1 - buf.get());
+            }
+            head = static_cast<size_t>(p - buf.get());
+        }
+
+        // Moves the unconsumed bytes to the front and reads until the window is full
+        // or the input ends. Returns false when nothing new could be read.
+        bool refill() {
+            if (eof) return false;
+            if (head > 0) {
+                std::memmove(buf.get(), at(), tail - head);
+                base += head;
+                tail -= head;
+                head = 0;
+            }
+            if (tail == capacity) {
+                throw std::runtime_error("error in tokenizer: token longer than the input window");
+            }
+            const size_t before = tail;
+#if defined(__unix__) || defined(__APPLE__)
+            while (tail < capacity) {
+                const auto n = ::read(fd, buf.get() + tail, capacity - tail);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("File could not be read");
+                }
+                if (n == 0) {
+                    eof = true;
+                    break;
+                }
+                tail += static_cast<size_t>(n);
+            }
+#else
+            throw std::runtime_error("streaming input is not supported on this platform");
+#endif
+            return tail > before;
+        }
+
+        // Pointer to the first byte in [at() + from, filled()) for which stop(c) holds.
+        // Refills while the scan runs off the window, so the result is either a
+        // stopping byte or filled() at end of input.
+        template<typename Stop>
+        const char* scanUntil(size_t from, Stop stop) {
+            for (;;) {
+                const char* p = at() + from;
+                while (p < filled() && !stop(*p)) ++p;
+                if (p < filled()) return p;
+                from = static_cast<size_t>(p - at());
+                if (!refill()) return filled();
+            }
+        }
+
+        [[nodiscard]] Token make(TokenType type, size_t length, int64_t value = 0) const {
+            const size_t offset = base + head;
+            return {type, std::string_view(at(), length), value, line, offset - lineStart + 1};
+        }
+
+        // one more byte is available after at() (refilling if needed)
+        bool hasNext() {
+            return head + 1 < tail || (refill() && head + 1 < tail);
+        }
+
+        void skipLine() {
+            for (;;) {
+                const char* nl = help::scan::findByte(at(), filled(), '\n');
+                if (nl < filled()) {
+                    seek(nl + 1);
+                    return;
+                }
+                seek(filled());
+                if (!refill()) return;
+            }
+        }
+
+        void skipMultiline() {
+            for (;;) {
+                const char* close = help::scan::findPair(at(), filled(), '*', '/');
+                if (close < filled()) {
+                    seek(close + 2);
+                    return;
+                }
+                if (filled() - at() > 1) seek(filled() - 1); // a '*' may pair with the next read
+                if (!refill()) {
+                    throw std::runtime_error("error in tokenizer: unterminated multi-line comment");
+                }
+            }
+        }
+
+        Token intProcess() {
+            const char* stop = scanUntil(1, [](const char c) {
+                return !(help::isAlpha(c) || help::isDigit(c) || c == '_');
+            });
+            const auto lit = help::parseIntLiteral(at(), stop);
+            switch (lit.status) {
+                case help::ParseStatus::Ok:
+                    break;
+                case help::ParseStatus::Overflow:
+                    throw std::runtime_error("error in tokenizer: integer literal too large");
+                case help::ParseStatus::Malformed:
+                    throw std::runtime_error("error in tokenizer: malformed integer literal");
+            }
+            return make(INT_LITERAL, lit.length, lit.value);
+        }
+
+        Token strProcess() {
+            const char* close = scanUntil(1, [](const char c) { return c == '"'; });
+            if (close == filled()) {
+                throw std::runtime_error("error in tokenizer: unterminated string");
+            }
+            return make(STRING_LITERAL, static_cast<size_t>(close + 1 - at()));
+        }
+
+        Token identProcess() {
+            const char* stop = scanUntil(1, [](const char c) {
+                return !(help::isAlpha(c) || help::isDigit(c) || help::isUnderscore(c));
+            });
+            const auto length = static_cast<size_t>(stop - at());
+            const auto type = classifyKeyword(std::string_view(at(), length));
+            if (type == IDENTIFIER) {
+                throw std::runtime_error("error in tokenizer: identifiers aren't allowed for now");
+            }
+            return make(type, length);
+        }
+
+    public:
+        explicit TokenStream(const int fd, const size_t window = 64 * 1024, const bool ownsFd = false)
+            : buf(new char[std::max<size_t>(window, 256)]), capacity(std::max<size_t>(window, 256)),
+              fd(fd), ownsFd(ownsFd) {}
+        TokenStream(const TokenStream&) = delete;
+        TokenStream& operator=(const TokenStream&) = delete;
+        ~TokenStream() {
+#if defined(__unix__) || defined(__APPLE__)
+            if (ownsFd) ::close(fd);
+#endif
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+        // "-" streams stdin
+        static std::unique_ptr<TokenStream> open(const std::filesystem::path& src,
+                                                 const size_t window = 64 * 1024) {
+            const mem::TagScope scope(mem::Tag::Tokenizer);
+            if (src == "-") return std::make_unique<TokenStream>(STDIN_FILENO, window);
+            const int fd = ::open(src.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("File could not be opened");
+            }
+            return std::make_unique<TokenStream>(fd, window, true);
+        }
+#endif
+
+        [[nodiscard]] size_t window() const noexcept { return capacity; }
+
+        // 1-based {line, column} of the next unread byte; just past the token after
+        // next() returns
+        [[nodiscard]] std::pair<size_t, size_t> position() const noexcept {
+            return {line, base + head - lineStart + 1};
+        }
+        // 1-based {line, column} of the token (or comment) next() is on; where a
+        // lexical error is reported
+        [[nodiscard]] std::pair<size_t, size_t> tokenPosition() const noexcept { return started; }
+
+        // Fills `out` with the next token; false at end of input
+        bool next(Token& out) {
+            for (;;) {
+                seek(help::scan::skipSpaces(at(), filled()));
+                if (head == tail) {
+                    if (!refill()) return false;
+                    continue;
+                }
+                started = position();
+                const char c = *at();
+                const char n = hasNext() ? at()[1] : '\0';
+
+                if (help::isDigit(c) || (c == '-' && help::isDigit(n))) {
+                    out = intProcess();
+                } else if (c == '/' && n == '/') {
+                    skipLine();
+                    continue;
+                } else if (c == '/' && n == '*') {
+                    seek(at() + 2);
+                    skipMultiline();
+                    continue;
+                } else if (c == '"') {
+                    out = strProcess();
+                } else if (help::isAlpha(c) || c == '_') {
+                    out = identProcess();
+                } else if (c == ';') {
+                    out = make(SEMICOLON, 1);
+                } else {
+                    seek(at() + 1);
+                    continue;
+                }
+                seek(at() + out.lexeme.size());
+                return true;
+            }
+        }
+
+        // Single-pass input iterator: for (const Token& t : stream) { ... }
+        class iterator {
+            TokenStream* stream = nullptr;
+            Token current;
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = Token;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Token*;
+            using reference = const Token&;
+
+            iterator() = default;
+            explicit iterator(TokenStream* s) : stream(s) { ++*this; }
+
+            reference operator*() const noexcept { return current; }
+            pointer operator->() const noexcept { return &current; }
+            iterator& operator++() {
+                if (!stream->next(current)) stream = nullptr;
+                return *this;
+            }
+            bool operator==(const iterator& o) const noexcept { return stream == o.stream; }
+            bool operator!=(const iterator& o) const noexcept { return stream != o.stream; }
+        };
+
+        iterator begin() { return iterator(this); }
+        static iterator end() { return {}; }
+    };
+}
+
+#endif // CINDRA_STREAM_H
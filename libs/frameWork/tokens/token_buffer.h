@@ -0,0 +1,125 @@
+//
+// token_buffer.h - struct-of-arrays token stream
+//
+#ifndef CINDRA_TOKEN_BUFFER_H
+#define CINDRA_TOKEN_BUFFER_H
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "token_type.h"
+#include "scan.h"
+#include "../memory/heap.h"
+
+namespace cid::tok {
+
+    // lexeme is a slice of the source handed to the Tokenizer (never owned), so the
+    // source buffer must outlive every token. Numeric payloads are stored inline.
+    struct Token {
+        TokenType type;
+        std::string_view lexeme;
+        int64_t value;
+        size_t line;
+        size_t column;
+
+        Token() : type(INVALID), lexeme("INVALID"), value(0), line(0), column(0) {}
+        Token(TokenType type, std::string_view lexeme, int64_t value,
+              size_t line, size_t column)
+            : type(type), lexeme(lexeme), value(value),
+              line(line), column(column) {}
+    };
+
+    // 1-based {line, column} of a source offset without building a line table; for
+    // one-off diagnostics
+    inline std::pair<size_t, size_t> locate(const std::string_view source, size_t offset) {
+        offset = std::min(offset, source.size());
+        const size_t line = 1 + help::scan::countNewlines(source.data(), source.data() + offset);
+        const size_t nl = offset ? source.rfind('\n', offset - 1) : std::string_view::npos;
+        return {line, nl == std::string_view::npos ? offset + 1 : offset - nl};
+    }
+
+    // Tokens are kept as parallel arrays (type / offset / length / literal, 17 bytes per
+    // token) so passes that only look at types walk one dense uint8 array. Line and
+    // column are not stored: they are derived from the offset through a line table
+    // built on first use.
+    class TokenBuffer {
+        std::string_view source;
+        std::vector<TokenType> types_;
+        std::vector<uint32_t> offsets_;
+        std::vector<uint32_t> lengths_;
+        std::vector<int64_t> literals_;
+        mutable std::vector<uint32_t> lineStarts; // lazily built, not thread-safe
+
+        void buildLines() const {
+            lineStarts.push_back(0);
+            help::scan::newlineOffsets(source.data(), source.data() + source.size(), lineStarts);
+        }
+
+    public:
+        TokenBuffer() = default;
+        explicit TokenBuffer(std::string_view source) : source(source) {
+            if (source.size() > UINT32_MAX)
+                throw std::runtime_error("error in tokenizer: source larger than 4 GiB");
+        }
+
+        // Large reservations (big inputs) get the process PageOptions
+        void reserve(size_t n) {
+            types_.reserve(n);
+            offsets_.reserve(n);
+            lengths_.reserve(n);
+            literals_.reserve(n);
+            mem::adviseBuffer(types_);
+            mem::adviseBuffer(offsets_);
+            mem::adviseBuffer(lengths_);
+            mem::adviseBuffer(literals_);
+        }
+
+        void push(TokenType type, size_t offset, size_t length, int64_t literal = 0) {
+            types_.push_back(type);
+            offsets_.push_back(static_cast<uint32_t>(offset));
+            lengths_.push_back(static_cast<uint32_t>(length));
+            literals_.push_back(literal);
+        }
+
+        // Concatenates tokens of the same source (used to stitch parallel chunks)
+        void append(const TokenBuffer& o) {
+            types_.insert(types_.end(), o.types_.begin(), o.types_.end());
+            offsets_.insert(offsets_.end(), o.offsets_.begin(), o.offsets_.end());
+            lengths_.insert(lengths_.end(), o.lengths_.begin(), o.lengths_.end());
+            literals_.insert(literals_.end(), o.literals_.begin(), o.literals_.end());
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return types_.size(); }
+        [[nodiscard]] bool empty() const noexcept { return types_.empty(); }
+        [[nodiscard]] std::string_view getSource() const noexcept { return source; }
+
+        [[nodiscard]] const std::vector<TokenType>& types() const noexcept { return types_; }
+        [[nodiscard]] TokenType type(size_t i) const noexcept { return types_[i]; }
+        [[nodiscard]] uint32_t offset(size_t i) const noexcept { return offsets_[i]; }
+        [[nodiscard]] int64_t literal(size_t i) const noexcept { return literals_[i]; }
+        [[nodiscard]] std::string_view lexeme(size_t i) const noexcept {
+            return source.substr(offsets_[i], lengths_[i]);
+        }
+
+        // 1-based {line, column} of a source offset
+        [[nodiscard]] std::pair<size_t, size_t> locate(size_t offset) const {
+            if (lineStarts.empty()) buildLines();
+            const auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+            const auto line = static_cast<size_t>(it - lineStarts.begin());
+            return {line, offset - *(it - 1) + 1};
+        }
+        [[nodiscard]] std::pair<size_t, size_t> position(size_t i) const {
+            return locate(offsets_[i]);
+        }
+
+        // Materialized view of one token, for diagnostics and debugging
+        [[nodiscard]] Token operator[](size_t i) const {
+            const auto [line, column] = position(i);
+            return {types_[i], lexeme(i), literals_[i], line, column};
+        }
+    };
+}
+
+#endif // CINDRA_TOKEN_BUFFER_H
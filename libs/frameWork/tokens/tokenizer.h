@@ -5,13 +5,17 @@
 #ifndef CINDRA_TOKENIZER_H
 #define CINDRA_TOKENIZER_H
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include <cstddef>
 #include "token_type.h"
+#include "token_buffer.h"
+#include "scan.h"
+#include "keywords.h"
+#include "number.h"
 #include "helper.h"
 #include <iostream>
-#include "../containers/unordered_dense_map.h"
 using std::vector;
 using std::string;
 using std::cout;
@@ -19,33 +23,20 @@ using std::cout;
 namespace cid::tok {
     using namespace help;
 
-    inline auto setUpkeywords() {
-        ankerl::unordered_dense::map<std::string, cid::tok::TokenType> tmp;
-        tmp["return"] = TokenType::RETURN;
-        tmp["print"] = TokenType::PRINT;
-        return tmp;
-    }
-    inline auto Keyword = setUpkeywords();
-
-    struct Token {
-        TokenType type;
-        std::vector<std::byte> data;
-        std::string lexeme;
-        size_t line;
-        size_t column;
-
-        Token() : type(INVALID), data(), lexeme("INVALID"), line(0), column(0) {}
-        Token(TokenType type, std::string lexeme, std::vector<std::byte> data,
-              size_t line, size_t column)
-            : type(type), data(std::move(data)), lexeme(std::move(lexeme)),
-              line(line), column(column) {}
+    // One lexed token as offsets into the source, before it is stored anywhere
+    struct RawToken {
+        TokenType type = INVALID;
+        size_t offset = 0;
+        size_t length = 0;
+        int64_t literal = 0;
     };
 
     class Tokenizer {
-        std::vector<Token> tokens;
-        const std::string input;
+        const std::string_view input;
+        TokenBuffer tokens;
         size_t current = 0;
-        size_t line = 1, column = 1; // Começa na linha 1
+        size_t from = 0;
+        size_t started = 0; // where lex() began the current token or comment
 
         [[nodiscard]] bool hasToken() const noexcept {
             return current < input.size();
@@ -53,95 +44,92 @@ namespace cid::tok {
         [[nodiscard]] char peek(size_t i = 0) const noexcept {
             return (current + i < input.size()) ? input[current + i] : '\0';
         }
+        // Line/column are not tracked here: TokenBuffer derives them from offsets.
         char next() noexcept {
-            const char c = input[current++];
-            if (c == '\n') {
-                ++line;
-                column = 1;
-            } else {
-                ++column;
-            }
-            return c;
+            return input[current++];
         }
+        [[nodiscard]] const char* at() const noexcept { return input.data() + current; }
+        [[nodiscard]] const char* end() const noexcept { return input.data() + input.size(); }
+        void seek(const char* p) noexcept { current = static_cast<size_t>(p - input.data()); }
+
         void skipLine() {
-            while (hasToken() && peek() != '\n') {
-                next();
-            }
+            seek(scan::findByte(at(), end(), '\n'));
             if (hasToken()) next(); // Consome o '\n'
         }
         void skipMultiline() {
-            while (hasToken()) {
-                if (peek() == '*' && peek(1) == '/') {
-                    next(); next();
-                    return;
-                }
-                next();
+            const char* close = scan::findPair(at(), end(), '*', '/');
+            if (close == end()) {
+                throw std::runtime_error("error in tokenizer: unterminated multi-line comment");
             }
-            throw std::runtime_error("error in tokenizer: unterminated multi-line comment");
+            seek(close + 2);
         }
-        void intProcess(char firstDigit) {
-            std::string token(1, firstDigit);
-            const size_t col = column - 1; // Coluna correta
-            while (hasToken() && isDigit(peek())) {
-                token += next();
-            }
-            try {
-                int value = std::stoi(token);
-                tokens.emplace_back(INT_LITERAL, token, to_byte(value), line, col);
-            } catch (...) {
-                throw std::runtime_error("error in tokenizer: integer literal too large");
+        RawToken intProcess() {
+            const size_t start = current - 1; // primeiro digito (ou '-') ja consumido
+            const auto lit = parseIntLiteral(input.data() + start, end());
+            switch (lit.status) {
+                case ParseStatus::Ok:
+                    break;
+                case ParseStatus::Overflow:
+                    throw std::runtime_error("error in tokenizer: integer literal too large");
+                case ParseStatus::Malformed:
+                    throw std::runtime_error("error in tokenizer: malformed integer literal");
             }
+            current = start + lit.length;
+            return {INT_LITERAL, start, lit.length, lit.value};
         }
-    public:
-        explicit Tokenizer(std::string source)
-            : input(std::move(source)) {
-            tokens.reserve(100);
-        }
-        void strProcess(const char c) {
-            std::string token(1, c); // Inclui a aspa inicial
-            const size_t col = column - 1;
+        RawToken strProcess() {
+            const size_t start = current - 1; // Inclui a aspa inicial
 
             while (hasToken() && peek() != '"') {
-                token += next();
+                next();
             }
 
             if (!hasToken()) {
                 throw std::runtime_error("error in tokenizer: unterminated string");
             }
 
-            token += next(); // Adiciona a aspa final
-            tokens.emplace_back(STRING_LITERAL, token, to_byte(token), line, col);
+            next(); // Consome a aspa final
+            return {STRING_LITERAL, start, current - start};
         }
-        void identProcess(char c) {
-            std::string token(1, c);
-            const size_t col = column - 1;
+        RawToken identProcess() {
+            const size_t start = current - 1;
 
             while (hasToken()) {
                 char n = peek();
                 if (!(isAlpha(n) || isDigit(n) || isUnderscore(n))) {
                     break;
                 }
-                token += next();
+                next();
             }
 
-            auto it = Keyword.find(token);
-            if (it != Keyword.end()) {
-                tokens.emplace_back(it->second, token, to_byte(token), line, col);
-            } else {
+            const auto token = input.substr(start, current - start);
+            const auto type = classifyKeyword(token);
+            if (type == IDENTIFIER) {
                 throw std::runtime_error("error in tokenizer: identifiers aren't allowed for now");
             }
+            return {type, start, token.size()};
         }
-        auto tokenize() {
-            if (input.empty()) return std::vector<Token>();
-
+    public:
+        // The source is viewed, not copied: it must outlive the tokens produced.
+        explicit Tokenizer(std::string_view source)
+            : input(source), tokens(source) {}
+        // Tokenizes only [from, to) of source; offsets stay relative to the whole source.
+        // The range must start and end outside strings and comments.
+        Tokenizer(std::string_view source, size_t from, size_t to)
+            : input(source.substr(0, to)), tokens(source), current(from), from(from) {}
+
+        // Lexes one token without storing it; false at end of input. Lets a consumer
+        // (e.g. the fused compiler) work token by token with no TokenBuffer at all.
+        bool lex(RawToken& out) {
             while (hasToken()) {
+                seek(scan::skipSpaces(at(), end()));
+                if (!hasToken()) break;
+                started = current;
                 char c = next();
 
-                if (isSpace(c)) continue;
-
-                if (isDigit(c) || c == '-' && isDigit(peek(1))) {
-                    intProcess(c);
-                    continue;
+                if (isDigit(c) || (c == '-' && isDigit(peek()))) {
+                    out = intProcess();
+                    return true;
                 }
 
                 if (c == '/' && peek() == '/') {
@@ -156,29 +144,54 @@ namespace cid::tok {
                 }
 
                 if (c == '"') {
-                    strProcess(c);
-                    continue;
+                    out = strProcess();
+                    return true;
                 }
 
                 if (isAlpha(c) || c == '_') {
-                    identProcess(c);
-                    continue;
+                    out = identProcess();
+                    return true;
                 }
 
                 if (c == ';') {
-                    tokens.emplace_back(SEMICOLON, ";", to_byte(0x0), line, column - 1);
-                    continue;
+                    out = {SEMICOLON, current - 1, 1};
+                    return true;
                 }
             }
+            return false;
+        }
+        // Source offset the lexer has reached
+        [[nodiscard]] size_t offset() const noexcept { return current; }
+        // Source offset of the token (or comment) lex() is on; where a lexical error is
+        // reported
+        [[nodiscard]] size_t tokenOffset() const noexcept { return started; }
+
+        // On a temporary the buffer is moved out; on an lvalue it stays owned here.
+        TokenBuffer tokenize() && {
+            run();
+            return std::move(tokens);
+        }
+        const TokenBuffer& tokenize() & {
+            run();
             return tokens;
         }
-        [[nodiscard]] const std::vector<Token>& getTokens() const noexcept {
+        [[nodiscard]] const TokenBuffer& getTokens() const noexcept {
             return tokens;
         }
+    private:
+        void run() {
+            const mem::TagScope scope(mem::Tag::Tokenizer);
+            tokens.reserve((input.size() - from) / 8 + 16);
+            RawToken t;
+            while (lex(t)) {
+                tokens.push(t.type, t.offset, t.length, t.literal);
+            }
+        }
     };
 
-    inline void printToken(const vector<cid::tok::Token>& tokens) {
-        for (const auto& token : tokens) {
+    inline void printToken(const TokenBuffer& tokens) {
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            const auto token = tokens[i];
             cout << "Token: ";
             switch (token.type) {
                 case cid::tok::PRINT:
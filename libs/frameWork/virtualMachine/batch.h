@@ -0,0 +1,111 @@
+//
+// batch.h - compile and run many scripts in one process
+//
+#ifndef CINDRA_BATCH_H
+#define CINDRA_BATCH_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "code.h"
+#include "cdb.h"
+#include "output.h"
+#include "../concurrency/threadPool.h"
+#include "../tokens/file.h"
+
+namespace cid::code {
+    struct BatchResult {
+        std::filesystem::path path;
+        bool ok = false;
+        int returnCode = 0;
+        std::string output; // everything the script printed
+        std::string error;  // set when !ok: the compile, verify or load error
+        uint64_t micros = 0; // open + compile + verify + run
+    };
+
+    // One script start to finish, with its own sink; .cdb images are loaded instead of
+    // compiled. Never throws: failures are reported in the result.
+    inline BatchResult runScript(const std::filesystem::path& path) {
+        BatchResult r;
+        r.path = path;
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            const auto code = [&] {
+                if (help::isBytecodeFile(path)) return loadCdb(path);
+                const auto source = help::openFile(path);
+                auto compiled = compile(source.view());
+                std::string err;
+                if (!verify(compiled, &err)) throw std::runtime_error(err);
+                return compiled;
+            }();
+            MemorySink out;
+            r.returnCode = unsafeRun(code, out);
+            r.output = out.str();
+            r.ok = true;
+        } catch (const std::exception& e) {
+            r.error = e.what();
+        }
+        r.micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        return r;
+    }
+
+    // Runs every script on the pool; results come back in input order. Workers pull the
+    // next index from a shared counter, so a script costs no task or future of its own.
+    inline std::vector<BatchResult> runBatch(const std::vector<std::filesystem::path>& scripts,
+                                             conc::ThreadPool& pool) {
+        std::vector<BatchResult> results(scripts.size());
+        std::atomic<size_t> next{0};
+        std::vector<std::future<void>> workers;
+        const size_t count = std::min(pool.size(), scripts.size());
+        workers.reserve(count);
+        for (size_t w = 0; w < count; ++w) {
+            workers.push_back(pool.submit([&] {
+                for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < scripts.size();) {
+                    results[i] = runScript(scripts[i]);
+                }
+            }));
+        }
+        for (auto& w : workers) w.get();
+        return results;
+    }
+
+    inline std::vector<BatchResult> runBatch(const std::vector<std::filesystem::path>& scripts,
+                                             const size_t threads = 0) {
+        conc::ThreadPool pool(threads);
+        return runBatch(scripts, pool);
+    }
+
+    // Scripts of a batch: the script files of a directory (not recursive, sorted), or the
+    // lines of a manifest file. Manifest paths are relative to the manifest; blank lines
+    // and lines starting with '#' are skipped.
+    inline std::vector<std::filesystem::path> batchScripts(const std::filesystem::path& source) {
+        std::vector<std::filesystem::path> scripts;
+        if (std::filesystem::is_directory(source)) {
+            for (const auto& e : std::filesystem::directory_iterator(source)) {
+                if (e.is_regular_file() && help::isValidExtension(e.path())) scripts.push_back(e.path());
+            }
+            std::sort(scripts.begin(), scripts.end());
+            return scripts;
+        }
+        std::ifstream manifest(source);
+        if (!manifest) throw std::runtime_error("batch manifest could not be opened");
+        const auto base = source.parent_path();
+        std::string line;
+        while (std::getline(manifest, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.pop_back();
+            const auto first = line.find_first_not_of(" \t");
+            if (first == std::string::npos || line[first] == '#') continue;
+            const std::filesystem::path p = line.substr(first);
+            scripts.push_back(p.is_absolute() ? p : base / p);
+        }
+        return scripts;
+    }
+}
+
+#endif // CINDRA_BATCH_H
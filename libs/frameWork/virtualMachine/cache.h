@@ -0,0 +1,149 @@
+//
+// cache.h - content-hash keyed compile cache of .cdb images
+//
+#ifndef CINDRA_CACHE_H
+#define CINDRA_CACHE_H
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#include "cdb.h"
+#include "../containers/unordered_dense_map.h"
+
+namespace cid::code {
+    // Maps source bytes to the CODE compiled from them, as .cdb images in one
+    // directory. The file name is a wyhash of the source plus its length, the encoding,
+    // CodegenVersion and CdbVersion, so any change to the compiler or the format misses
+    // instead of loading stale code; the image itself records a second, independent
+    // hash of the source, and an image whose hash differs is a miss too. Writes go
+    // through writeCdb's rename, so processes can share a directory. Recency is the file's mtime, refreshed on every hit; the
+    // least recently used images are evicted once the directory exceeds its budget.
+    // The cache is best effort: every I/O failure reads as a miss.
+    class CompileCache {
+        std::filesystem::path dir;
+        uint64_t maxBytes;
+
+        [[nodiscard]] std::filesystem::path entry(const std::string_view source, const Encoding encoding) const {
+            const uint64_t hash = ankerl::unordered_dense::detail::wyhash::hash(source.data(), source.size());
+            char name[96];
+            std::snprintf(name, sizeof(name), "%016llx-%llx-e%u-c%u-f%u.cdb", static_cast<unsigned long long>(hash),
+                          static_cast<unsigned long long>(source.size()), static_cast<unsigned>(encoding),
+                          static_cast<unsigned>(CodegenVersion), static_cast<unsigned>(CdbVersion));
+            return dir / name;
+        }
+
+    public:
+        static constexpr uint64_t DefaultMaxBytes = 256ull << 20;
+        // A writer's temporary older than this belongs to a writer that died mid-write
+        static constexpr std::chrono::minutes StaleTemporary{10};
+
+        explicit CompileCache(std::filesystem::path dir, const uint64_t maxBytes = DefaultMaxBytes)
+            : dir(std::move(dir)), maxBytes(maxBytes) {}
+
+        // Off unless asked for, since it writes files outside the working directory:
+        // CINDRA_CACHE_DIR names the directory, or CINDRA_CACHE=1 picks
+        // $XDG_CACHE_HOME/cindra, else $HOME/.cache/cindra. An empty CINDRA_CACHE_DIR
+        // keeps it off. CINDRA_CACHE_MAX_MB sets the budget.
+        static std::optional<CompileCache> fromEnvironment() {
+            std::filesystem::path dir;
+            if (const char* d = std::getenv("CINDRA_CACHE_DIR")) {
+                if (!*d) return std::nullopt;
+                dir = d;
+            } else if (const char* on = std::getenv("CINDRA_CACHE"); !on || std::string_view(on) != "1") {
+                return std::nullopt;
+            } else if (const char* x = std::getenv("XDG_CACHE_HOME"); x && *x) {
+                dir = std::filesystem::path(x) / "cindra";
+            } else if (const char* h = std::getenv("HOME"); h && *h) {
+                dir = std::filesystem::path(h) / ".cache" / "cindra";
+            } else {
+                return std::nullopt;
+            }
+            uint64_t budget = DefaultMaxBytes;
+            if (const char* mb = std::getenv("CINDRA_CACHE_MAX_MB"); mb && *mb) {
+                budget = std::strtoull(mb, nullptr, 10) << 20;
+            }
+            return CompileCache(std::move(dir), budget);
+        }
+
+        [[nodiscard]] const std::filesystem::path& directory() const noexcept { return dir; }
+
+        // Verified CODE for source, or nothing; an unreadable or corrupt entry is dropped,
+        // one compiled from other source (a name collision) left for store to replace
+        [[nodiscard]] std::optional<CODE> lookup(const std::string_view source,
+                                                 const Encoding encoding = Encoding::Bytes) const {
+            const auto path = entry(source, encoding);
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(path, ec)) return std::nullopt;
+            try {
+                auto file = std::make_shared<help::SourceFile>(help::SourceFile::map(path));
+                const auto bytes = file->view();
+                if (cdbSource(bytes) != detail::secondHash(source.data(), source.size())) return std::nullopt;
+                auto code = detail::adoptCdb(bytes, std::move(file), path.string());
+                std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+                return code;
+            } catch (const std::exception&) {
+                std::filesystem::remove(path, ec);
+                return std::nullopt;
+            }
+        }
+
+        // Stores code compiled from source, then evicts down to the budget
+        void store(const std::string_view source, const CODE& code) const {
+            std::error_code ec;
+            std::filesystem::create_directories(dir, ec);
+            if (ec) return;
+            try {
+                writeCdb(code, entry(source, code.getEncoding()), detail::secondHash(source.data(), source.size()));
+            } catch (const std::exception&) {
+                return;
+            }
+            evict();
+        }
+
+        // Removes temporaries left by crashed writers, then least recently used images
+        // until the total size fits the budget
+        void evict() const {
+            struct Image {
+                std::filesystem::path path;
+                std::filesystem::file_time_type used;
+                uint64_t size;
+            };
+            std::vector<Image> images;
+            uint64_t total = 0;
+            std::error_code ec;
+            const auto now = std::filesystem::file_time_type::clock::now();
+            for (auto it = std::filesystem::directory_iterator(dir, ec);
+                 !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                if (it->path().extension() == ".tmp") {
+                    std::error_code stat;
+                    const auto written = it->last_write_time(stat);
+                    if (!stat && now - written > StaleTemporary) std::filesystem::remove(it->path(), stat);
+                    continue;
+                }
+                if (it->path().extension() != ".cdb") continue;
+                std::error_code stat;
+                const auto size = it->file_size(stat);
+                const auto used = it->last_write_time(stat);
+                if (stat) continue;
+                images.push_back({it->path(), used, size});
+                total += size;
+            }
+            if (total <= maxBytes) return;
+            std::sort(images.begin(), images.end(), [](const Image& a, const Image& b) { return a.used < b.used; });
+            for (const auto& image : images) {
+                if (total <= maxBytes) break;
+                if (std::filesystem::remove(image.path, ec)) total -= image.size;
+            }
+        }
+    };
+}
+
+#endif // CINDRA_CACHE_H
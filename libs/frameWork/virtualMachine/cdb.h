@@ -0,0 +1,209 @@
+//
+// cdb.h - precompiled bytecode images (.cdb)
+//
+#ifndef CINDRA_CDB_H
+#define CINDRA_CDB_H
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "code.h"
+#include "../tokens/file.h"
+#include "../containers/unordered_dense_map.h"
+
+namespace cid::code {
+    // A .cdb file is CODE as it sits in memory, so loading is a mapping plus pointer
+    // fix-ups: a header, then the instruction section, the pool's offset table and the
+    // pool's bytes, each at an 8-byte aligned offset. Written in native byte order; a
+    // file from a machine of the other order is rejected, not swapped.
+    inline constexpr char CdbMagic[4] = {'C', 'I', 'D', 'B'};
+    inline constexpr uint16_t CdbVersion = 2;
+    inline constexpr uint32_t CdbByteOrder = 0x01020304;
+
+    struct CdbHeader {
+        char magic[4];
+        uint16_t version;
+        uint8_t encoding;
+        uint8_t reserved0;
+        uint32_t byteOrder;
+        uint32_t reserved1;
+        uint64_t checksum; // over every byte after the header
+        uint64_t source;   // detail::secondHash of the source compiled, 0 when not recorded
+        uint64_t codeOffset, codeSize;             // instruction section, in bytes
+        uint64_t poolTableOffset, poolEntries;     // poolEntries + 1 uint32 offsets
+        uint64_t poolBytesOffset, poolBytesSize;
+    };
+    static_assert(sizeof(CdbHeader) == 80, "CdbHeader is part of the file format");
+
+    namespace detail {
+        inline uint64_t cdbChecksum(const char* p, const size_t n) {
+            return ankerl::unordered_dense::detail::wyhash::hash(p, n);
+        }
+        // A 64-bit hash unrelated to wyhash (MurmurHash64A under its own seed), for
+        // telling apart inputs whose wyhash collides
+        inline uint64_t secondHash(const char* p, size_t n) {
+            constexpr uint64_t m = 0xc6a4a7935bd1e995ull;
+            constexpr int r = 47;
+            uint64_t h = 0x5851f42d4c957f2dull ^ (n * m);
+            for (; n >= 8; p += 8, n -= 8) {
+                uint64_t k;
+                std::memcpy(&k, p, 8);
+                k *= m;
+                k ^= k >> r;
+                k *= m;
+                h ^= k;
+                h *= m;
+            }
+            if (n) {
+                uint64_t k = 0;
+                std::memcpy(&k, p, n);
+                h ^= k;
+                h *= m;
+            }
+            h ^= h >> r;
+            h *= m;
+            h ^= h >> r;
+            return h;
+        }
+        inline size_t cdbAlign(const size_t n) { return (n + 7) & ~size_t{7}; }
+        inline uint64_t cdbWriterId() {
+#ifdef CINDRA_HAS_MMAP
+            return static_cast<uint64_t>(::getpid());
+#else
+            return std::hash<std::thread::id>{}(std::this_thread::get_id());
+#endif
+        }
+    }
+
+    // Writes src to path through a temporary file renamed into place, so a reader
+    // never maps a half-written image. `source`, if given, is recorded in the header.
+    inline void writeCdb(const CODE& src, const std::filesystem::path& path, const uint64_t source = 0) {
+        const auto& pool = src.getPool();
+        const auto& table = pool.offsetTable();
+        const auto poolText = pool.data();
+        const bool wordCode = src.getEncoding() == Encoding::Words;
+        const char* code = wordCode ? reinterpret_cast<const char*>(src.getWords().data())
+                                    : reinterpret_cast<const char*>(src.getCode().data());
+
+        CdbHeader h{};
+        std::memcpy(h.magic, CdbMagic, sizeof(h.magic));
+        h.version = CdbVersion;
+        h.encoding = static_cast<uint8_t>(src.getEncoding());
+        h.byteOrder = CdbByteOrder;
+        h.source = source;
+        h.codeOffset = sizeof(CdbHeader);
+        h.codeSize = src.byteSize();
+        h.poolTableOffset = detail::cdbAlign(h.codeOffset + h.codeSize);
+        h.poolEntries = pool.size();
+        h.poolBytesOffset = detail::cdbAlign(h.poolTableOffset + table.size() * sizeof(uint32_t));
+        h.poolBytesSize = poolText.size();
+
+        std::string image(h.poolBytesOffset + h.poolBytesSize, '\0');
+        if (h.codeSize) std::memcpy(&image[h.codeOffset], code, h.codeSize);
+        std::memcpy(&image[h.poolTableOffset], table.data(), table.size() * sizeof(uint32_t));
+        if (h.poolBytesSize) std::memcpy(&image[h.poolBytesOffset], poolText.data(), h.poolBytesSize);
+        h.checksum = detail::cdbChecksum(image.data() + sizeof(CdbHeader), image.size() - sizeof(CdbHeader));
+        std::memcpy(&image[0], &h, sizeof(h));
+
+        // unique per writer, so concurrent writers of one path never share a temporary
+        static std::atomic<uint32_t> serial{0};
+        auto tmp = path;
+        tmp += "." + std::to_string(detail::cdbWriterId()) + "." + std::to_string(serial++) + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out.write(image.data(), static_cast<std::streamsize>(image.size())) || !out.flush())
+                throw std::runtime_error("could not write " + tmp.string());
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if (ec) {
+            std::filesystem::remove(tmp, ec);
+            throw std::runtime_error("could not write " + path.string());
+        }
+    }
+
+    // The sections of the result are borrowed from bytes, which owner keeps alive for as
+    // long as the CODE. The header, section bounds, checksum and pool table are checked,
+    // then the code is verified, so the result goes straight to unsafeRun.
+    inline CODE detail::adoptCdb(const std::string_view bytes, std::shared_ptr<const void> owner,
+                                 const std::string& name) {
+        auto fail = [&](const std::string& why) -> void {
+            throw std::runtime_error("invalid .cdb file " + name + ": " + why);
+        };
+
+        CdbHeader h{};
+        if (bytes.size() < sizeof(h)) fail("truncated header");
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        if (std::memcmp(h.magic, CdbMagic, sizeof(h.magic)) != 0) fail("bad magic");
+        if (h.version != CdbVersion) fail("unsupported version " + std::to_string(h.version));
+        if (h.byteOrder != CdbByteOrder) fail("written with another byte order");
+        if (h.encoding > static_cast<uint8_t>(Encoding::Varint)) fail("unknown encoding");
+        const auto encoding = static_cast<Encoding>(h.encoding);
+
+        // every section inside the file, aligned, and without overflow in the sums
+        auto inside = [&](const uint64_t offset, const uint64_t size) {
+            return offset % 8 == 0 && offset >= sizeof(h) && offset <= bytes.size() && size <= bytes.size() - offset;
+        };
+        if (h.poolEntries >= UINT32_MAX) fail("constant pool too large");
+        const uint64_t tableSize = (h.poolEntries + 1) * sizeof(uint32_t);
+        if (!inside(h.codeOffset, h.codeSize) || !inside(h.poolTableOffset, tableSize) ||
+            !inside(h.poolBytesOffset, h.poolBytesSize))
+            fail("section outside the file");
+        if (h.poolBytesSize > UINT32_MAX) fail("constant pool too large");
+        if (encoding == Encoding::Words && h.codeSize % sizeof(uint32_t) != 0) fail("partial instruction word");
+        if (reinterpret_cast<uintptr_t>(bytes.data()) % alignof(uint64_t) != 0) fail("misaligned image");
+
+        if (detail::cdbChecksum(bytes.data() + sizeof(h), bytes.size() - sizeof(h)) != h.checksum)
+            fail("checksum mismatch");
+
+        // runners index the pool unchecked, so its table must be sound
+        const auto* table = reinterpret_cast<const uint32_t*>(bytes.data() + h.poolTableOffset);
+        if (table[0] != 0 || table[h.poolEntries] != h.poolBytesSize) fail("bad constant pool table");
+        for (uint64_t i = 0; i < h.poolEntries; ++i) {
+            if (table[i] > table[i + 1]) fail("bad constant pool table");
+        }
+
+        const char* code = bytes.data() + h.codeOffset;
+        auto pool = ConstantPool::borrow(bytes.data() + h.poolBytesOffset, h.poolBytesSize, table, h.poolEntries);
+        CODE result = encoding == Encoding::Words
+            ? CODE(encoding, {}, Section<uint32_t>::borrow(reinterpret_cast<const uint32_t*>(code), h.codeSize / 4),
+                   std::move(pool), owner)
+            : CODE(encoding, Section<uint8_t>::borrow(reinterpret_cast<const uint8_t*>(code), h.codeSize), {},
+                   std::move(pool), owner);
+
+        std::string err;
+        if (!verify(result, &err)) fail(err);
+        return result;
+    }
+    // Maps a .cdb file into runnable CODE without copying it; the mapping lives as long
+    // as the CODE
+    inline CODE loadCdb(const std::filesystem::path& path) {
+        auto file = std::make_shared<help::SourceFile>(help::SourceFile::map(path));
+        const auto bytes = file->view();
+        return detail::adoptCdb(bytes, std::move(file), path.string());
+    }
+
+    // The source hash recorded by writeCdb, or 0 for an image too short to have one
+    inline uint64_t cdbSource(const std::string_view image) noexcept {
+        CdbHeader h{};
+        if (image.size() < sizeof(h)) return 0;
+        std::memcpy(&h, image.data(), sizeof(h));
+        return h.source;
+    }
+
+    // Same, for an image received in memory (e.g. over a socket); takes the buffer over
+    inline CODE loadCdbImage(std::string image, const std::string& name = "<memory>") {
+        auto owned = std::make_shared<const std::string>(std::move(image));
+        const std::string_view bytes = *owned;
+        return detail::adoptCdb(bytes, std::move(owned), name);
+    }
+}
+
+#endif // CINDRA_CDB_H
@@ -4,22 +4,30 @@
 
 #ifndef CINDRA_CODE_H
 #define CINDRA_CODE_H
+#include <algorithm>
+#include <string>
 #include <string_view>
 #include <type_traits>
 #include <stdexcept>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include "../tokens/tokenizer.h"
+#include "../tokens/stream.h"
 #include "../parser/parser.h"
+#include "output.h"
+#include "constants.h"
+#include "encoding.h"
+#include "section.h"
 
 namespace cid::code {
 
-    // Append raw bytes from std::byte storage into uint8_t vector
-    inline void insertByte(std::vector<uint8_t>& a, const std::vector<std::byte>& b) {
-        a.insert(a.end(),
-                 reinterpret_cast<const uint8_t*>(b.data()),
-                 reinterpret_cast<const uint8_t*>(b.data()) + b.size());
-    }
+    // Bumped whenever the generators emit different code for the same source; part of
+    // every compile cache key (see cache.h)
+    inline constexpr uint32_t CodegenVersion = 1;
 
-    // Small helpers to encode PODs and strings in our bytecode format
+    // Small helpers to encode PODs in our bytecode format
     template <typename T>
     inline void appendPOD(std::vector<uint8_t>& out, const T& value) {
         static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
@@ -29,77 +37,186 @@ namespace cid::code {
 
     inline void appendU8(std::vector<uint8_t>& out, uint8_t v) { out.push_back(v); }
 
-    inline void appendLenString(std::vector<uint8_t>& out, std::string_view s) {
-        // Limit to 255 for now (safe path will validate)
-        if (s.size() > 255) throw std::runtime_error("string too long");
-        appendU8(out, static_cast<uint8_t>(s.size()));
-        const auto* p = reinterpret_cast<const uint8_t*>(s.data());
-        out.insert(out.end(), p, p + s.size());
+    // Bytecode int operands are 32-bit; wider literals are rejected at codegen time
+    inline int narrowInt(const int64_t v) {
+        if (v < INT32_MIN || v > INT32_MAX) throw std::runtime_error("integer literal does not fit in int");
+        return static_cast<int>(v);
+    }
+
+    class CODE;
+    class ThreadedCode;
+    namespace detail {
+        // Builds CODE over a .cdb image held by owner (see cdb.h)
+        inline CODE adoptCdb(std::string_view image, std::shared_ptr<const void> owner, const std::string& name);
+        // Translates freshly verified CODE for unsafeRun (see ThreadedCode)
+        inline void attachThreaded(CODE& src);
     }
 
 class CODE {
     private:
-        std::vector<uint8_t> code;
-        explicit CODE(std::vector<uint8_t>&& codeVec) : code(std::move(codeVec)) {}
+        Encoding encoding = Encoding::Bytes;
+        Section<uint8_t> code;   // Encoding::Bytes and Encoding::Varint
+        Section<uint32_t> words; // Encoding::Words
+        ConstantPool pool;
+        std::shared_ptr<const void> backing; // keeps borrowed sections alive
+        size_t instructions = 0;             // counted by verify()
+        bool verified = false;
+        // Built once by verify(), shared by copies; holds no pointer into the CODE (the
+        // pool is passed to each run), so it stays valid however the CODE is moved or copied
+        std::shared_ptr<const ThreadedCode> threaded;
+        CODE(const Encoding enc, std::vector<uint8_t>&& codeVec, std::vector<uint32_t>&& wordVec,
+             ConstantPool&& constants)
+            : encoding(enc), code(std::move(codeVec)), words(std::move(wordVec)), pool(std::move(constants)) {
+            pool.seal();
+        }
+        // Code whose sections live in `image`, e.g. a mapped .cdb file
+        CODE(const Encoding enc, Section<uint8_t>&& codeSec, Section<uint32_t>&& wordSec, ConstantPool&& constants,
+             std::shared_ptr<const void> image)
+            : encoding(enc), code(std::move(codeSec)), words(std::move(wordSec)), pool(std::move(constants)),
+              backing(std::move(image)) {}
 
     public:
-        [[nodiscard]] const std::vector<uint8_t>& getCode() const { return code; }
+        [[nodiscard]] Encoding getEncoding() const noexcept { return encoding; }
+        [[nodiscard]] const Section<uint8_t>& getCode() const { return code; }
+        [[nodiscard]] const Section<uint32_t>& getWords() const { return words; }
+        // Size of the instruction stream in bytes, constant pool excluded
+        [[nodiscard]] size_t byteSize() const noexcept { return code.size() + words.size() * sizeof(uint32_t); }
+        // Number of instructions, dead code included; known once verified
+        [[nodiscard]] size_t instructionCount() const noexcept { return instructions; }
+        [[nodiscard]] const ConstantPool& getPool() const noexcept { return pool; }
+        // Set by verify(); unsafeRun only accepts verified code
+        [[nodiscard]] bool isVerified() const noexcept { return verified; }
+        // What unsafeRun dispatches over; null until verified
+        [[nodiscard]] const ThreadedCode* threadedCode() const noexcept { return threaded.get(); }
+
+        friend bool verify(CODE&, std::string*);
+        friend void detail::attachThreaded(CODE&);
 
-        // Only the bytecode generators can construct CODE instances
-        friend CODE unsafePrototypeCode(const std::vector<tok::Token>&);
+        // Only the bytecode generators (through their shared CodeWriter) can construct
+        // CODE instances
+        friend class CodeWriter;
+        friend CODE detail::adoptCdb(std::string_view, std::shared_ptr<const void>, const std::string&);
         friend CODE generateByteCode(const par::CindraParserTree&);
     };
 
+    // Back end shared by the generators: appends instructions in the encoding chosen at
+    // codegen time and interns their string constants.
+    class CodeWriter {
+        Encoding encoding;
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> words;
+        ConstantPool pool;
+
+        void emitWord(const Op op, const uint32_t operand, const bool narrow) {
+            if (narrow) {
+                words.push_back(word::make(op, operand));
+            } else {
+                words.push_back(word::makeWide(op));
+                words.push_back(operand);
+            }
+        }
+
+        void emitVarint(const Op op, const uint32_t operand) {
+            appendU8(bytes, static_cast<uint8_t>(op));
+            varint::append(bytes, operand);
+        }
+
+    public:
+        explicit CodeWriter(const Encoding encoding = Encoding::Bytes) : encoding(encoding) {}
+
+        void reserve(const size_t instructions) {
+            if (encoding == Encoding::Words) {
+                words.reserve(instructions);
+                mem::adviseBuffer(words);
+            } else {
+                bytes.reserve(instructions * (encoding == Encoding::Varint ? 2 : 6));
+                mem::adviseBuffer(bytes);
+            }
+        }
+
+        void printInt(const int v) {
+            if (encoding == Encoding::Words) return emitWord(Op::PrintInt, static_cast<uint32_t>(v), word::fitsInt(v));
+            if (encoding == Encoding::Varint) return emitVarint(Op::PrintInt, varint::zigzag(v));
+            appendU8(bytes, static_cast<uint8_t>(tok::PRINT));
+            appendU8(bytes, static_cast<uint8_t>(tok::INT_LITERAL));
+            appendPOD(bytes, v);
+        }
+
+        void printString(const std::string_view s) {
+            const uint32_t index = pool.intern(s);
+            if (encoding == Encoding::Words) return emitWord(Op::PrintString, index, word::fitsIndex(index));
+            if (encoding == Encoding::Varint) return emitVarint(Op::PrintString, index);
+            appendU8(bytes, static_cast<uint8_t>(tok::PRINT));
+            appendU8(bytes, static_cast<uint8_t>(tok::STRING_LITERAL));
+            appendPOD(bytes, index);
+        }
+
+        void ret(const int v) {
+            if (encoding == Encoding::Words) return emitWord(Op::Return, static_cast<uint32_t>(v), word::fitsInt(v));
+            if (encoding == Encoding::Varint) return emitVarint(Op::Return, varint::zigzag(v));
+            appendU8(bytes, static_cast<uint8_t>(tok::RETURN));
+            appendPOD(bytes, v);
+        }
+
+        // Every generated program ends with an implicit `return 0;`, so execution never
+        // runs off the end of the bytecode (it is dead code after an explicit RETURN)
+        CODE finish() && {
+            ret(0);
+            return CODE(encoding, std::move(bytes), std::move(words), std::move(pool));
+        }
+    };
+
+    // Operand encoders shared by the buffered and the streaming generators
+    inline void emitPrintOperand(CodeWriter& out, const tok::TokenType type, const int64_t literal,
+                                 std::string_view lexeme) {
+        if (type == tok::INT_LITERAL) {
+            out.printInt(narrowInt(literal));
+        } else if (type == tok::STRING_LITERAL) {
+            // lexeme includes quotes; remove them if present
+            if (lexeme.size() >= 2 && lexeme.front() == '"' && lexeme.back() == '"') {
+                lexeme = lexeme.substr(1, lexeme.size() - 2);
+            }
+            out.printString(lexeme);
+        } else {
+            throw std::runtime_error("PRINT expects a literal operand");
+        }
+    }
+
+    inline void emitReturnOperand(CodeWriter& out, const tok::TokenType type, const int64_t literal) {
+        if (type != tok::INT_LITERAL)
+            throw std::runtime_error("RETURN expects int literal");
+        out.ret(narrowInt(literal));
+    }
+
     // Optional forward declaration if planner-based generation is added later
     CODE generateByteCode(const par::CindraParserTree& parser);
 
-    // Bytecode format (minimal):
+    // Bytecode format (minimal), for Encoding::Bytes (see encoding.h for Words):
     // - PRINT: [PRINT opcode][type tag (INT_LITERAL|STRING_LITERAL)] [payload]
     //   - INT_LITERAL payload: 4 bytes (int)
-    //   - STRING_LITERAL payload: 1-byte length, then bytes (no quotes)
+    //   - STRING_LITERAL payload: 4-byte index into the CODE's constant pool, which
+    //     holds each distinct literal once (no quotes, any length)
     // - RETURN: [RETURN opcode][4-byte int]
-    inline CODE unsafePrototypeCode(const std::vector<tok::Token>& src) {
-        std::vector<uint8_t> code;
-        code.reserve(src.size() * 6); // rough estimate to minimize reallocs
-
-        auto encodeStringLiteral = [&](const tok::Token& t) {
-            // token.lexeme includes quotes; remove them if present
-            std::string_view sv{t.lexeme};
-            if (sv.size() >= 2 && sv.front() == '"' && sv.back() == '"') {
-                sv = sv.substr(1, sv.size() - 2);
-            }
-            appendLenString(code, sv);
-        };
+    // Only the type array is walked; offsets/literals are touched for operands alone.
+    inline CODE unsafePrototypeCode(const tok::TokenBuffer& src, const Encoding encoding = Encoding::Bytes) {
+        const mem::TagScope scope(mem::Tag::Codegen);
+        CodeWriter code(encoding);
+        code.reserve(src.size() / 3 + 1); // PRINT, operand, ';'
+        const auto& types = src.types();
 
-        for (size_t i = 0; i < src.size(); ++i) {
-            const auto& t = src[i];
-            switch (t.type) {
+        for (size_t i = 0; i < types.size(); ++i) {
+            switch (types[i]) {
                 case tok::PRINT: {
-                    appendU8(code, static_cast<uint8_t>(tok::PRINT));
                     // Expect a literal next (int or string)
-                    if (i + 1 >= src.size()) throw std::runtime_error("PRINT missing operand");
-                    const auto& op = src[++i];
-                    if (op.type == tok::INT_LITERAL) {
-                        appendU8(code, static_cast<uint8_t>(tok::INT_LITERAL));
-                        // data holds POD bytes for int
-                        if (op.data.size() != sizeof(int))
-                            throw std::runtime_error("INT literal encoding size mismatch");
-                        insertByte(code, op.data);
-                    } else if (op.type == tok::STRING_LITERAL) {
-                        appendU8(code, static_cast<uint8_t>(tok::STRING_LITERAL));
-                        encodeStringLiteral(op);
-                    } else {
-                        throw std::runtime_error("PRINT expects a literal operand");
-                    }
+                    if (i + 1 >= types.size()) throw std::runtime_error("PRINT missing operand");
+                    const auto op = ++i;
+                    emitPrintOperand(code, types[op], src.literal(op), src.lexeme(op));
                     break;
                 }
                 case tok::RETURN: {
-                    appendU8(code, static_cast<uint8_t>(tok::RETURN));
-                    if (i + 1 >= src.size()) throw std::runtime_error("RETURN missing operand");
-                    const auto& op = src[++i];
-                    if (op.type != tok::INT_LITERAL || op.data.size() != sizeof(int))
-                        throw std::runtime_error("RETURN expects int literal");
-                    insertByte(code, op.data);
+                    if (i + 1 >= types.size()) throw std::runtime_error("RETURN missing operand");
+                    const auto op = ++i;
+                    emitReturnOperand(code, types[op], src.literal(op));
                     break;
                 }
                 case tok::SEMICOLON:
@@ -114,11 +231,349 @@ class CODE {
             }
         }
 
-        return CODE(std::move(code));
+        return std::move(code).finish();
+    }
+
+    // Same bytecode as above, emitted while the stream is pulled: at no point is more
+    // than one token (and the stream's input window) alive. Accepts the grammar of
+    // compile() and reports errors the same way, "error at line L, column C: ...".
+    inline CODE unsafePrototypeCode(tok::TokenStream& src, const Encoding encoding = Encoding::Bytes) {
+        const mem::TagScope scope(mem::Tag::Codegen);
+        CodeWriter code(encoding);
+        tok::Token t;
+
+        auto fail = [](const std::pair<size_t, size_t> at, const std::string_view msg) {
+            throw std::runtime_error("error at line " + std::to_string(at.first) + ", column " +
+                                     std::to_string(at.second) + ": " + std::string(msg));
+        };
+        auto here = [&] { return std::pair<size_t, size_t>{t.line, t.column}; };
+        auto next = [&]() -> bool {
+            try {
+                return src.next(t);
+            } catch (const std::runtime_error& e) {
+                fail(src.tokenPosition(), e.what());
+            }
+            return false;
+        };
+        // the position just past the current token, for errors at end of input
+        auto expect = [&](const char* msg) {
+            const auto after = src.position();
+            if (!next()) fail(after, msg);
+        };
+        auto expectSemicolon = [&](const char* msg) {
+            expect(msg);
+            if (t.type != tok::SEMICOLON) fail(here(), msg);
+        };
+        auto intOperand = [&] {
+            if (t.value < INT32_MIN || t.value > INT32_MAX) fail(here(), "INT literal out of range");
+            return static_cast<int>(t.value);
+        };
+
+        while (next()) {
+            switch (t.type) {
+                case tok::PRINT:
+                    expect("PRINT missing operand");
+                    if (t.type == tok::INT_LITERAL) {
+                        code.printInt(intOperand());
+                        expectSemicolon("missing ';' after PRINT int");
+                    } else if (t.type == tok::STRING_LITERAL) {
+                        code.printString(t.lexeme.substr(1, t.lexeme.size() - 2));
+                        expectSemicolon("missing ';' after PRINT string");
+                    } else {
+                        fail(here(), "PRINT expects literal");
+                    }
+                    break;
+                case tok::RETURN:
+                    expect("RETURN missing operand");
+                    if (t.type != tok::INT_LITERAL) fail(here(), "RETURN expects int literal");
+                    code.ret(intOperand());
+                    expectSemicolon("missing ';' after RETURN");
+                    break;
+                case tok::SEMICOLON:
+                    break; // stray semicolons are allowed
+                default:
+                    fail(here(), "unsupported token at top-level");
+            }
+        }
+        return std::move(code).finish();
+    }
+
+    // Fused front end: lexes, validates and emits in one pass over the source, with no
+    // token buffer in between. Accepts exactly the grammar of par::validateProgram and
+    // emits the same bytecode as unsafePrototypeCode; every error (lexical included)
+    // is reported as "error at line L, column C: ...".
+    inline CODE compile(const std::string_view src, const Encoding encoding = Encoding::Bytes) {
+        const mem::TagScope scope(mem::Tag::Codegen);
+        CodeWriter code(encoding);
+        code.reserve(src.size() / 8 + 2); // about one instruction per 8 bytes of source
+        tok::Tokenizer lexer(src);
+        tok::RawToken t;
+
+        auto fail = [&](const size_t offset, const std::string_view msg) {
+            const auto [line, column] = tok::locate(src, offset);
+            throw std::runtime_error("error at line " + std::to_string(line) + ", column " +
+                                     std::to_string(column) + ": " + std::string(msg));
+        };
+        auto lex = [&]() -> bool {
+            try {
+                return lexer.lex(t);
+            } catch (const std::runtime_error& e) {
+                fail(lexer.tokenOffset(), e.what());
+            }
+            return false;
+        };
+        auto expectSemicolon = [&](const char* msg) {
+            const size_t after = t.offset + t.length;
+            if (!lex()) fail(after, msg);
+            if (t.type != tok::SEMICOLON) fail(t.offset, msg);
+        };
+        // the operand's own range check, reported at the operand
+        auto intOperand = [&] {
+            if (t.literal < INT32_MIN || t.literal > INT32_MAX) fail(t.offset, "INT literal out of range");
+            return static_cast<int>(t.literal);
+        };
+
+        while (lex()) {
+            switch (t.type) {
+                case tok::PRINT: {
+                    if (!lex()) fail(t.offset + t.length, "PRINT missing operand");
+                    if (t.type == tok::INT_LITERAL) {
+                        code.printInt(intOperand());
+                        expectSemicolon("missing ';' after PRINT int");
+                    } else if (t.type == tok::STRING_LITERAL) {
+                        code.printString(src.substr(t.offset + 1, t.length - 2));
+                        expectSemicolon("missing ';' after PRINT string");
+                    } else {
+                        fail(t.offset, "PRINT expects literal");
+                    }
+                    break;
+                }
+                case tok::RETURN: {
+                    if (!lex()) fail(t.offset + t.length, "RETURN missing operand");
+                    if (t.type != tok::INT_LITERAL) fail(t.offset, "RETURN expects int literal");
+                    code.ret(intOperand());
+                    expectSemicolon("missing ';' after RETURN");
+                    break;
+                }
+                case tok::SEMICOLON:
+                    break; // stray semicolons are allowed
+                default:
+                    fail(t.offset, "unsupported token at top-level");
+            }
+        }
+        return std::move(code).finish();
+    }
+
+    // One linear pass proving that every opcode and type tag is known, that every
+    // operand and string lies inside the buffer, that instructions tile it exactly and
+    // that a RETURN is reached. On success the code is marked verified, which is what
+    // lets unsafeRun drop all per-instruction checks, and translated once to the
+    // threaded form unsafeRun dispatches over.
+    inline bool verify(CODE& src, std::string* err = nullptr) {
+        const bool wordCode = src.encoding == Encoding::Words;
+        size_t at = 0;
+        auto fail = [&](const char* m) {
+            if (err) *err = std::string("invalid bytecode at ") + (wordCode ? "word " : "byte ") +
+                            std::to_string(at) + ": " + m;
+            return false;
+        };
+
+        bool returns;
+        size_t count = 0;
+        if (wordCode) {
+            const auto& words = src.words;
+            returns = words.empty();
+            size_t i = 0;
+            while (i < words.size()) {
+                at = i;
+                const uint32_t w = words[i++];
+                const Op op = word::kind(w);
+                if (op != Op::PrintInt && op != Op::PrintString && op != Op::Return)
+                    return fail("invalid opcode encountered");
+                uint32_t operand = word::indexOperand(w);
+                if (word::isWide(w)) {
+                    if (operand != 0) return fail("wide opcode with an inline operand");
+                    if (i >= words.size()) return fail("truncated wide operand");
+                    operand = words[i++];
+                }
+                if (op == Op::PrintString && operand >= src.pool.size())
+                    return fail("string index outside the constant pool");
+                if (op == Op::Return) returns = true;
+                ++count;
+            }
+            at = i;
+        } else if (src.encoding == Encoding::Varint) {
+            const auto& code = src.code;
+            returns = code.empty();
+            size_t i = 0;
+            while (i < code.size()) {
+                at = i;
+                const auto op = static_cast<Op>(code[i++]);
+                if (op != Op::PrintInt && op != Op::PrintString && op != Op::Return)
+                    return fail("invalid opcode encountered");
+                uint32_t operand;
+                if (!varint::readSafe(code, i, operand)) return fail("truncated or oversized varint operand");
+                if (op == Op::PrintString && operand >= src.pool.size())
+                    return fail("string index outside the constant pool");
+                if (op == Op::Return) returns = true;
+                ++count;
+            }
+            at = i;
+        } else {
+            const auto& code = src.code;
+            returns = code.empty(); // unsafeRun returns 0 on empty code
+            size_t i = 0;
+            while (i < code.size()) {
+                at = i;
+                switch (code[i++]) {
+                    case tok::PRINT: {
+                        if (i >= code.size()) return fail("PRINT missing type tag");
+                        const auto tag = code[i++];
+                        if (tag == tok::INT_LITERAL) {
+                            if (code.size() - i < sizeof(int)) return fail("truncated int literal in PRINT");
+                            i += sizeof(int);
+                        } else if (tag == tok::STRING_LITERAL) {
+                            uint32_t index;
+                            if (!cid::help::readSafe(code, i, index)) return fail("truncated string index in PRINT");
+                            if (index >= src.pool.size()) return fail("string index outside the constant pool");
+                        } else {
+                            return fail("invalid type tag in PRINT");
+                        }
+                        break;
+                    }
+                    case tok::RETURN:
+                        if (code.size() - i < sizeof(int)) return fail("truncated return value");
+                        i += sizeof(int);
+                        returns = true;
+                        break;
+                    default:
+                        return fail("invalid opcode encountered");
+                }
+                ++count;
+            }
+            at = i;
+        }
+        if (!returns) return fail("execution runs past the end (no RETURN)");
+        src.instructions = count;
+        src.verified = true;
+        detail::attachThreaded(src);
+        return true;
+    }
+
+    // Decodes verified code of either encoding in execution order, calling
+    // fn(Op, operand) up to and including the first RETURN. Int operands come as their
+    // 32-bit pattern. For load-time passes; the runners decode inline.
+    template<typename Fn>
+    void forEachInstruction(const CODE& src, Fn&& fn) {
+        if (src.getEncoding() == Encoding::Words) {
+            const auto& words = src.getWords();
+            size_t i = 0;
+            while (i < words.size()) {
+                const uint32_t w = words[i++];
+                const Op op = word::kind(w);
+                uint32_t operand;
+                if (word::isWide(w)) operand = words[i++];
+                else if (op == Op::PrintString) operand = word::indexOperand(w);
+                else operand = static_cast<uint32_t>(word::intOperand(w));
+                fn(op, operand);
+                if (op == Op::Return) return;
+            }
+            return;
+        }
+        if (src.getEncoding() == Encoding::Varint) {
+            const auto& code = src.getCode();
+            const uint8_t* p = code.data();
+            const uint8_t* const end = p + code.size();
+            while (p < end) {
+                const auto op = static_cast<Op>(*p++);
+                uint32_t operand = varint::read(p);
+                if (op != Op::PrintString) operand = static_cast<uint32_t>(varint::unzigzag(operand));
+                fn(op, operand);
+                if (op == Op::Return) return;
+            }
+            return;
+        }
+        const auto& code = src.getCode();
+        size_t i = 0;
+        while (i < code.size()) {
+            uint32_t operand;
+            if (code[i++] == tok::RETURN) {
+                std::memcpy(&operand, &code[i], sizeof(operand));
+                fn(Op::Return, operand);
+                return;
+            }
+            // verified: anything else is PRINT
+            const Op op = code[i++] == tok::INT_LITERAL ? Op::PrintInt : Op::PrintString;
+            std::memcpy(&operand, &code[i], sizeof(operand));
+            i += sizeof(operand);
+            fn(op, operand);
+        }
+    }
+
+    namespace detail {
+        inline int safeRunWords(const CODE& src, OutputSink& out) {
+            const auto& words = src.getWords();
+            const auto& pool = src.getPool();
+            size_t i = 0;
+            while (i < words.size()) {
+                const uint32_t w = words[i++];
+                const Op op = word::kind(w);
+                uint32_t operand = word::indexOperand(w);
+                if (word::isWide(w)) {
+                    if (i >= words.size()) throw std::runtime_error("truncated wide operand");
+                    operand = words[i++];
+                } else if (op != Op::PrintString) {
+                    operand = static_cast<uint32_t>(word::intOperand(w));
+                }
+                switch (op) {
+                    case Op::PrintInt:
+                        out.writeInt(static_cast<int32_t>(operand));
+                        break;
+                    case Op::PrintString:
+                        if (operand >= pool.size()) throw std::runtime_error("string index outside the constant pool");
+                        out.write(pool[operand]);
+                        break;
+                    case Op::Return:
+                        return static_cast<int32_t>(operand);
+                    default:
+                        throw std::runtime_error("invalid opcode encountered");
+                }
+            }
+            return 0;
+        }
+
+        inline int safeRunVarint(const CODE& src, OutputSink& out) {
+            const auto& code = src.getCode();
+            const auto& pool = src.getPool();
+            size_t i = 0;
+            while (i < code.size()) {
+                const auto op = static_cast<Op>(code[i++]);
+                uint32_t operand;
+                if (!varint::readSafe(code, i, operand)) throw std::runtime_error("truncated or oversized varint operand");
+                switch (op) {
+                    case Op::PrintInt:
+                        out.writeInt(varint::unzigzag(operand));
+                        break;
+                    case Op::PrintString:
+                        if (operand >= pool.size()) throw std::runtime_error("string index outside the constant pool");
+                        out.write(pool[operand]);
+                        break;
+                    case Op::Return:
+                        return varint::unzigzag(operand);
+                    default:
+                        throw std::runtime_error("invalid opcode encountered");
+                }
+            }
+            return 0;
+        }
     }
 
     // SAFE: portable, defensive checks, no computed gotos
-    inline int safeRun(const CODE& src) {
+    inline int safeRun(const CODE& src, OutputSink& out = stdoutSink()) {
+        const mem::TagScope scope(mem::Tag::VM);
+        const FlushOnExit flushed(out);
+        if (src.getEncoding() == Encoding::Words) return detail::safeRunWords(src, out);
+        if (src.getEncoding() == Encoding::Varint) return detail::safeRunVarint(src, out);
         const auto& code = src.getCode();
         size_t i = 0;
         int returnValue = 0;
@@ -133,12 +588,14 @@ class CODE {
                         int value{};
                         if (!cid::help::readSafe(code, i, value))
                             throw std::runtime_error("truncated int literal in PRINT");
-                        std::cout << value;
+                        out.writeInt(value);
                     } else if (typeTag == tok::STRING_LITERAL) {
-                        std::string str;
-                        if (!cid::help::readStringSafe(code, i, str))
-                            throw std::runtime_error("truncated string literal in PRINT");
-                        std::cout << str;
+                        uint32_t index{};
+                        if (!cid::help::readSafe(code, i, index))
+                            throw std::runtime_error("truncated string index in PRINT");
+                        if (index >= src.getPool().size())
+                            throw std::runtime_error("string index outside the constant pool");
+                        out.write(src.getPool()[index]);
                     } else {
                         throw std::runtime_error("invalid type tag in PRINT");
                     }
@@ -159,9 +616,84 @@ class CODE {
         return returnValue;
     }
 
-    // UNSAFE: fast path, assumes well-formed code, uses computed gotos and minimal checks
-    inline int unsafeRun(const CODE& src) {
+    namespace detail {
+        // Word-stream counterpart of unsafeRunIndexed: the dispatch table is indexed by
+        // the low byte of each aligned word, wide forms included
+        inline int unsafeRunWords(const CODE& src, OutputSink& out) {
+            const auto& pool = src.getPool();
+            const uint32_t* pc = src.getWords().data();
+            uint32_t w;
+
+            cid::help::FunctionState<Op, 256> dTable;
+            dTable.Register(Op::PrintInt, &&PRINT_INT);
+            dTable.Register(Op::PrintString, &&PRINT_STRING);
+            dTable.Register(Op::Return, &&RETURN);
+            dTable.Register(static_cast<Op>(word::makeWide(Op::PrintInt)), &&PRINT_INT_WIDE);
+            dTable.Register(static_cast<Op>(word::makeWide(Op::PrintString)), &&PRINT_STRING_WIDE);
+            dTable.Register(static_cast<Op>(word::makeWide(Op::Return)), &&RETURN_WIDE);
+
+            DISPATCH:
+                w = *pc++;
+                goto *dTable[static_cast<size_t>(w & 0xFF)];
+
+            PRINT_INT:
+                out.writeInt(word::intOperand(w));
+                goto DISPATCH;
+            PRINT_STRING:
+                out.write(pool[word::indexOperand(w)]);
+                goto DISPATCH;
+            RETURN:
+                return word::intOperand(w);
+            PRINT_INT_WIDE:
+                out.writeInt(static_cast<int32_t>(*pc++));
+                goto DISPATCH;
+            PRINT_STRING_WIDE:
+                out.write(pool[*pc++]);
+                goto DISPATCH;
+            RETURN_WIDE:
+                return static_cast<int32_t>(*pc);
+        }
+
+        // Varint counterpart: one opcode byte, then an operand that is almost always a
+        // single byte
+        inline int unsafeRunVarint(const CODE& src, OutputSink& out) {
+            const auto& pool = src.getPool();
+            const uint8_t* pc = src.getCode().data();
+
+            cid::help::FunctionState<Op, 256> dTable;
+            dTable.Register(Op::PrintInt, &&PRINT_INT);
+            dTable.Register(Op::PrintString, &&PRINT_STRING);
+            dTable.Register(Op::Return, &&RETURN);
+
+            DISPATCH:
+                goto *dTable[static_cast<size_t>(*pc++)];
+
+            PRINT_INT:
+                out.writeInt(varint::unzigzag(varint::read(pc)));
+                goto DISPATCH;
+            PRINT_STRING:
+                out.write(pool[varint::read(pc)]);
+                goto DISPATCH;
+            RETURN:
+                return varint::unzigzag(varint::read(pc));
+        }
+    }
+
+    // UNSAFE, byte-indexed: reads each opcode byte, indexes a dispatch table and decodes
+    // operands inline. Superseded by the threaded unsafeRun below; kept as the baseline
+    // for bench/dispatch. Only runs code that passed verify().
+    inline int unsafeRunIndexed(const CODE& src, OutputSink& out = stdoutSink()) {
+        const mem::TagScope scope(mem::Tag::VM);
+        if (!src.isVerified()) throw std::runtime_error("unsafeRun requires verified bytecode");
+        const FlushOnExit flushed(out);
+        if (src.getEncoding() == Encoding::Words) {
+            return src.getWords().empty() ? 0 : detail::unsafeRunWords(src, out);
+        }
+        if (src.getEncoding() == Encoding::Varint) {
+            return src.getCode().empty() ? 0 : detail::unsafeRunVarint(src, out);
+        }
         const auto& code = src.getCode();
+        const auto& pool = src.getPool();
         if (code.empty()) return 0;
 
         size_t i = 0;
@@ -178,14 +710,16 @@ class CODE {
         PRINT: {
             const uint8_t type = code[i++];
             if (type == static_cast<uint8_t>(tok::INT_LITERAL)) {
-                const int v = *reinterpret_cast<const int*>(&code[i]);
+                int v;
+                std::memcpy(&v, &code[i], sizeof(int));
                 i += sizeof(int);
-                std::cout << v;
+                out.writeInt(v);
                 goto DISPATCH;
             } else if (type == static_cast<uint8_t>(tok::STRING_LITERAL)) {
-                const uint8_t len = code[i++];
-                std::cout.write(reinterpret_cast<const char*>(&code[i]), len);
-                i += len;
+                uint32_t index;
+                std::memcpy(&index, &code[i], sizeof(index));
+                i += sizeof(index);
+                out.write(pool[index]);
                 goto DISPATCH;
             } else {
                 return 0; // invalid
@@ -193,10 +727,197 @@ class CODE {
         }
 
         RETURN: {
-            const int v = *reinterpret_cast<const int*>(&code[i]);
+            int v;
+            std::memcpy(&v, &code[i], sizeof(int));
             return v;
         }
     }
 
+
+    // Direct-threaded form of verified CODE: one 8-byte cell per instruction holding
+    // its handler and its already decoded operand, so dispatch is a single indirect
+    // jump through the next cell. The handler is stored as a 16-bit offset from the
+    // first handler rather than a full pointer, which halves the stream's footprint.
+    struct alignas(8) ThreadedCell {
+        int16_t label;
+        uint8_t b;  // length of a short string
+        uint32_t a; // int operand, offset of a short string in the pool's bytes, pool
+                    // index of a long string, or blob length
+    };
+
+    namespace detail {
+        // PrintBlob and PrintReturn are superinstructions made by the fusion pass. Strings
+        // of up to 255 bytes carry their length in the cell so the copy stays inline.
+        enum class ThreadedOp : uint8_t { PrintInt, PrintString, Return, PrintBlob, PrintReturn, PrintLongString };
+
+        // With cells == nullptr, hands out the handler offsets (indexed by ThreadedOp)
+        // instead of running. Offsets are only meaningful within one copy of the
+        // function, hence noinline/noclone.
+#ifdef __clang__
+        __attribute__((noinline))
+#else
+        __attribute__((noinline, noclone))
+#endif
+        inline int runThreaded(const ThreadedCell* cells, const ConstantPool* pool, const char* blob,
+                               const char* blobEnd, OutputSink& out, const int16_t** labels = nullptr) {
+            const char* const base = static_cast<const char*>(&&PRINT_INT);
+            if (!cells) {
+                // checked once, so a handler that grows the function cannot wrap silently
+                auto offset = [base](const void* handler) {
+                    const auto d = static_cast<const char*>(handler) - base;
+                    if (d < INT16_MIN || d > INT16_MAX)
+                        throw std::logic_error("threaded handler out of int16_t range of the first one");
+                    return static_cast<int16_t>(d);
+                };
+                static const int16_t handlers[] = {
+                    0,
+                    offset(&&PRINT_STRING),
+                    offset(&&RETURN),
+                    offset(&&PRINT_BLOB),
+                    offset(&&PRINT_RETURN),
+                    offset(&&PRINT_LONG_STRING),
+                };
+                *labels = handlers;
+                return 0;
+            }
+            const char* const strings = pool->data().data();
+            const ThreadedCell* pc = cells;
+            goto *(base + pc->label);
+
+            PRINT_INT:
+                out.writeInt(static_cast<int32_t>(pc->a));
+                ++pc;
+                goto *(base + pc->label);
+            PRINT_STRING:
+                out.write(strings + pc->a, pc->b);
+                ++pc;
+                goto *(base + pc->label);
+            PRINT_LONG_STRING:
+                out.write((*pool)[pc->a]);
+                ++pc;
+                goto *(base + pc->label);
+            RETURN:
+                return static_cast<int32_t>(pc->a);
+            // blobs are consumed in program order, so a cursor replaces per-cell offsets
+            PRINT_BLOB:
+                out.write(blob, pc->a);
+                blob += pc->a;
+                ++pc;
+                goto *(base + pc->label);
+            // the rest of the blob, then return
+            PRINT_RETURN:
+                out.write(blob, static_cast<size_t>(blobEnd - blob));
+                return static_cast<int32_t>(pc->a);
+        }
+    }
+
+    enum class Fusion : uint8_t { None, Superinstructions };
+
+    // Load-time translation of verified CODE, built in one pass. Instructions after the
+    // first RETURN are unreachable and dropped, so the stream always ends in a RETURN.
+    //
+    // With Fusion::Superinstructions (the default) the pass also rewrites the two
+    // sequences that dominate the opcode n-gram profile of generated scripts (see
+    // OpcodeProfile): a run of constant PRINTs becomes one PrintBlob over output
+    // formatted ahead of time, and a final run of PRINTs plus its RETURN becomes a
+    // single PrintReturn. The blob holds at most MaxBlob bytes: a PRINT whose output
+    // would overflow it gets a cell of its own and ends the current run, while later,
+    // shorter ones that still fit start new PrintBlob runs. Strings that are not fused
+    // are referred to by pool offset and index only and read from the pool passed to
+    // run(), so a ThreadedCode keeps no pointer into the CODE it was translated from.
+    //
+    // verify() builds one per CODE and keeps it with the CODE, so unsafeRun never
+    // translates again.
+    class ThreadedCode {
+    public:
+        // Bound on the output fused into the blob, so a long straight-line script is not
+        // held twice: once as code, once as its own output
+        static constexpr size_t MaxBlob = 8 * 1024;
+
+    private:
+        std::vector<ThreadedCell> cells;
+        std::string blob;
+
+    public:
+        explicit ThreadedCode(const CODE& src, const Fusion fusion = Fusion::Superinstructions) {
+            if (!src.isVerified()) throw std::runtime_error("threading requires verified bytecode");
+            const int16_t* labels;
+            detail::runThreaded(nullptr, nullptr, nullptr, nullptr, stdoutSink(), &labels);
+            auto label = [&](detail::ThreadedOp op) { return labels[static_cast<size_t>(op)]; };
+            const bool fuse = fusion == Fusion::Superinstructions;
+            const auto& pool = src.getPool();
+
+            cells.reserve(fuse ? std::min<size_t>(src.instructionCount() + 1, 64) : src.instructionCount() + 1);
+            size_t pending = 0; // blob bytes not yet covered by a PrintBlob
+            bool returned = false;
+            auto endBlobRun = [&] {
+                if (pending) cells.push_back({label(detail::ThreadedOp::PrintBlob), 0, static_cast<uint32_t>(pending)});
+                pending = 0;
+            };
+            auto ret = [&](const uint32_t v) {
+                if (pending) {
+                    cells.push_back({label(detail::ThreadedOp::PrintReturn), 0, v});
+                } else {
+                    cells.push_back({label(detail::ThreadedOp::Return), 0, v});
+                }
+                returned = true;
+            };
+
+            // output formatted ahead of time goes to the blob if it still fits under
+            // MaxBlob; otherwise the run ends and the PRINT gets a cell of its own
+            auto toBlob = [&](const std::string_view text) {
+                if (!fuse || blob.size() + text.size() > MaxBlob) {
+                    endBlobRun();
+                    return false;
+                }
+                blob.append(text);
+                pending += text.size();
+                return true;
+            };
+
+            forEachInstruction(src, [&](const Op op, const uint32_t operand) {
+                if (op == Op::Return) return ret(operand);
+                if (op == Op::PrintInt) {
+                    char digits[16];
+                    const auto end = std::to_chars(digits, digits + sizeof(digits), static_cast<int32_t>(operand)).ptr;
+                    if (!toBlob({digits, static_cast<size_t>(end - digits)}))
+                        cells.push_back({label(detail::ThreadedOp::PrintInt), 0, operand});
+                    return;
+                }
+                const auto str = pool[operand];
+                if (toBlob(str)) {
+                    return;
+                } else if (str.size() <= UINT8_MAX) {
+                    const auto offset = static_cast<uint32_t>(str.data() - pool.data().data());
+                    cells.push_back({label(detail::ThreadedOp::PrintString), static_cast<uint8_t>(str.size()), offset});
+                } else {
+                    cells.push_back({label(detail::ThreadedOp::PrintLongString), 0, operand});
+                }
+            });
+            if (!returned) ret(0); // empty code returns 0
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return cells.size(); }
+        [[nodiscard]] size_t blobSize() const noexcept { return blob.size(); }
+
+        // strings must hold the same constants as the pool this was translated from:
+        // that CODE's pool, wherever it has been copied or moved to since
+        int run(const ConstantPool& strings, OutputSink& out = stdoutSink()) const {
+            const FlushOnExit flushed(out);
+            return detail::runThreaded(cells.data(), &strings, blob.data(), blob.data() + blob.size(), out);
+        }
+    };
+
+    inline void detail::attachThreaded(CODE& src) {
+        src.threaded = std::make_shared<const ThreadedCode>(src);
+    }
+
+    // UNSAFE: fast path over verified code; dispatches over the threaded cells verify()
+    // built
+    inline int unsafeRun(const CODE& src, OutputSink& out = stdoutSink()) {
+        const mem::TagScope scope(mem::Tag::VM);
+        if (!src.threadedCode()) throw std::runtime_error("unsafeRun requires verified bytecode");
+        return src.threadedCode()->run(src.getPool(), out);
+    }
 }
 #endif //CINDRA_CODE_H
@@ -0,0 +1,96 @@
+//
+// constants.h - interned constant pool carried by CODE
+//
+#ifndef CINDRA_CONSTANTS_H
+#define CINDRA_CONSTANTS_H
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../containers/unordered_dense_map.h"
+#include "../memory/heap.h"
+#include "section.h"
+
+namespace cid::code {
+    namespace detail {
+        // lets the interning table be probed with a string_view, without a temporary
+        struct StringHash {
+            using is_transparent = void;
+            using is_avalanching = void;
+            [[nodiscard]] uint64_t operator()(const std::string_view s) const noexcept {
+                return ankerl::unordered_dense::hash<std::string_view>{}(s);
+            }
+        };
+    }
+
+    // String constants referenced from bytecode by 32-bit index. Entries are stored back
+    // to back in one buffer with an offset table (entry i is [offsets[i], offsets[i+1])),
+    // so a lookup is two loads and the pool serializes as two flat arrays. Each distinct
+    // literal is stored once; the interning table only lives while code is generated,
+    // its keys copied into an arena that seal() drops in one go. A pool loaded from an
+    // image borrows both arrays instead (see cdb.h).
+    class ConstantPool {
+        Section<char> bytes;
+        Section<uint32_t> offsets;
+        mem::Arena keys{16 * 1024};
+        ankerl::unordered_dense::map<std::string_view, uint32_t, detail::StringHash> interned;
+
+        void reindex() {
+            for (uint32_t i = 0; i < size(); ++i) interned.emplace(keys.copy((*this)[i]), i);
+        }
+
+    public:
+        ConstantPool() { offsets.push_back(0); }
+        // A copy of a pool still being built can go on interning
+        ConstantPool(const ConstantPool& o) : bytes(o.bytes), offsets(o.offsets) {
+            if (!o.interned.empty()) reindex();
+        }
+        ConstantPool(ConstantPool&&) noexcept = default;
+        ConstantPool& operator=(ConstantPool o) noexcept {
+            bytes = std::move(o.bytes);
+            offsets = std::move(o.offsets);
+            keys = std::move(o.keys);
+            interned = std::move(o.interned);
+            return *this;
+        }
+
+        // Views `count` entries laid out as above; the caller has checked that the table
+        // is non-decreasing and ends at `size`, and keeps both arrays alive
+        static ConstantPool borrow(const char* chars, const size_t size, const uint32_t* table, const size_t count) {
+            ConstantPool pool;
+            pool.bytes = Section<char>::borrow(chars, size);
+            pool.offsets = Section<uint32_t>::borrow(table, count + 1);
+            return pool;
+        }
+
+        uint32_t intern(const std::string_view s) {
+            if (const auto it = interned.find(s); it != interned.end()) return it->second;
+            if (s.size() > UINT32_MAX - bytes.size())
+                throw std::runtime_error("constant pool larger than 4 GiB");
+            const auto id = static_cast<uint32_t>(size());
+            bytes.append(s.data(), s.size());
+            offsets.push_back(static_cast<uint32_t>(bytes.size()));
+            interned.emplace(keys.copy(s), id);
+            return id;
+        }
+
+        // Drops the interning table once no more constants will be added
+        void seal() {
+            interned = {};
+            keys.release();
+            offsets.shrink_to_fit();
+            bytes.shrink_to_fit();
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return offsets.size() - 1; }
+        [[nodiscard]] std::string_view operator[](const uint32_t i) const noexcept {
+            return {bytes.data() + offsets[i], offsets[i + 1] - offsets[i]};
+        }
+        [[nodiscard]] std::string_view data() const noexcept { return {bytes.data(), bytes.size()}; }
+        [[nodiscard]] const Section<uint32_t>& offsetTable() const noexcept { return offsets; }
+    };
+}
+
+#endif // CINDRA_CONSTANTS_H
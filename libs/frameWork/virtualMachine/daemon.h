@@ -0,0 +1,476 @@
+//
+// daemon.h - long-lived compile-and-run server over a UNIX domain socket
+//
+#ifndef CINDRA_DAEMON_H
+#define CINDRA_DAEMON_H
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "code.h"
+#include "cdb.h"
+#include "output.h"
+#include "../concurrency/threadPool.h"
+#include "../containers/unordered_dense_map.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CINDRA_HAS_UNIX_SOCKETS 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cid::code {
+    // Wire format, in native byte order since both ends share a machine. A connection
+    // carries any number of request/reply pairs: a RequestHeader and `size` payload
+    // bytes, answered by a ReplyHeader and `size` bytes of output (or, when !ok, of
+    // error text).
+    enum class Payload : uint32_t { Source = 1, Image = 2 }; // script text, or a .cdb image
+
+    struct RequestHeader {
+        uint32_t payload;
+        uint32_t reserved;
+        uint64_t size;
+    };
+    struct ReplyHeader {
+        uint32_t ok;
+        int32_t returnCode;
+        uint64_t size;
+    };
+    inline constexpr uint64_t MaxPayload = 1ull << 30;
+
+    struct DaemonReply {
+        bool ok = false;
+        int returnCode = 0;
+        std::string output; // or the error text when !ok
+    };
+
+    // Verified CODE by payload hash, least recently used evicted first. Each entry also
+    // keeps a second, independent hash of its payload, so two payloads whose keys
+    // collide never share CODE. Entries are shared, so a run keeps its CODE alive even
+    // if it is evicted meanwhile.
+    class CodeCache {
+        struct Entry {
+            std::shared_ptr<const CODE> code;
+            uint64_t check;
+            std::list<uint64_t>::iterator recent;
+        };
+        std::mutex lock;
+        std::list<uint64_t> order; // most recent first
+        ankerl::unordered_dense::map<uint64_t, Entry> entries;
+        size_t capacity;
+
+    public:
+        explicit CodeCache(const size_t capacity = 1024) : capacity(capacity ? capacity : 1) {}
+
+        static uint64_t key(const Payload kind, const std::string_view bytes) {
+            using namespace ankerl::unordered_dense::detail;
+            return wyhash::hash(wyhash::hash(bytes.data(), bytes.size()) ^ static_cast<uint64_t>(kind));
+        }
+        static uint64_t check(const std::string_view bytes) {
+            return detail::secondHash(bytes.data(), bytes.size());
+        }
+
+        std::shared_ptr<const CODE> find(const uint64_t key, const uint64_t check) {
+            const std::lock_guard<std::mutex> guard(lock);
+            const auto it = entries.find(key);
+            if (it == entries.end() || it->second.check != check) return nullptr;
+            order.splice(order.begin(), order, it->second.recent);
+            return it->second.code;
+        }
+
+        void insert(const uint64_t key, const uint64_t check, std::shared_ptr<const CODE> code) {
+            const std::lock_guard<std::mutex> guard(lock);
+            if (const auto it = entries.find(key); it != entries.end()) {
+                order.splice(order.begin(), order, it->second.recent);
+                // the same payload, built first by another worker; else a colliding
+                // one, which takes the slot over
+                if (it->second.check != check) it->second = Entry{std::move(code), check, it->second.recent};
+                return;
+            }
+            if (entries.size() >= capacity) {
+                entries.erase(order.back());
+                order.pop_back();
+            }
+            order.push_front(key);
+            entries.emplace(key, Entry{std::move(code), check, order.begin()});
+        }
+
+        size_t size() {
+            const std::lock_guard<std::mutex> guard(lock);
+            return entries.size();
+        }
+    };
+
+    // Runs one request against the cache: hashes the payload, compiles (or loads) and
+    // verifies on a miss, then runs into a private sink. Never throws.
+    inline DaemonReply serveRequest(CodeCache& cache, const Payload kind, std::string payload) {
+        DaemonReply reply;
+        try {
+            const uint64_t key = CodeCache::key(kind, payload);
+            const uint64_t check = CodeCache::check(payload);
+            auto code = cache.find(key, check);
+            if (!code) {
+                if (kind == Payload::Image) {
+                    code = std::make_shared<const CODE>(loadCdbImage(std::move(payload)));
+                } else {
+                    auto compiled = compile(payload);
+                    std::string err;
+                    if (!verify(compiled, &err)) throw std::runtime_error(err);
+                    code = std::make_shared<const CODE>(std::move(compiled));
+                }
+                cache.insert(key, check, code);
+            }
+            MemorySink out;
+            reply.returnCode = unsafeRun(*code, out);
+            reply.output = out.str();
+            reply.ok = true;
+        } catch (const std::exception& e) {
+            reply.output = e.what();
+        }
+        return reply;
+    }
+
+#ifdef CINDRA_HAS_UNIX_SOCKETS
+    namespace detail {
+        inline bool readFull(const int fd, void* p, size_t n) {
+            auto* at = static_cast<char*>(p);
+            while (n) {
+                const auto got = ::read(fd, at, n);
+                if (got == 0) return false;
+                if (got < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                at += got;
+                n -= static_cast<size_t>(got);
+            }
+            return true;
+        }
+
+        // Same, but gives up at deadline however the bytes trickle in
+        inline bool readFull(const int fd, void* p, size_t n, const std::chrono::steady_clock::time_point deadline) {
+            auto* at = static_cast<char*>(p);
+            while (n) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+                if (left <= 0) return false;
+                pollfd ready{fd, POLLIN, 0};
+                const int polled = ::poll(&ready, 1, static_cast<int>(std::min<long long>(left, INT_MAX)));
+                if (polled < 0 && errno == EINTR) continue;
+                if (polled <= 0) return false;
+                const auto got = ::read(fd, at, n);
+                if (got == 0) return false;
+                if (got < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                    return false;
+                }
+                at += got;
+                n -= static_cast<size_t>(got);
+            }
+            return true;
+        }
+
+        // send(2) rather than write(2) so a vanished peer is an error, not SIGPIPE
+        inline bool writeFull(const int fd, const void* p, size_t n) {
+#ifdef MSG_NOSIGNAL
+            constexpr int flags = MSG_NOSIGNAL;
+#else
+            constexpr int flags = 0;
+#endif
+            const auto* at = static_cast<const char*>(p);
+            while (n) {
+                const auto sent = ::send(fd, at, n, flags);
+                if (sent < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                at += sent;
+                n -= static_cast<size_t>(sent);
+            }
+            return true;
+        }
+
+        inline sockaddr_un socketAddress(const std::filesystem::path& path) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            const auto& s = path.native();
+            if (s.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path too long: " + s);
+            std::memcpy(addr.sun_path, s.c_str(), s.size() + 1);
+            return addr;
+        }
+
+        inline int unixSocket() {
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) throw std::runtime_error("socket could not be created");
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            return fd;
+        }
+
+        // Removes a socket file left behind by a daemon that is gone. Anything else at
+        // path, a live daemon's socket included, is left alone and reported.
+        inline void removeStaleSocket(const std::filesystem::path& path, const sockaddr_un& addr) {
+            struct stat st{};
+            if (::lstat(path.c_str(), &st) != 0) {
+                if (errno == ENOENT) return;
+                throw std::runtime_error("could not inspect " + path.string());
+            }
+            if (!S_ISSOCK(st.st_mode)) throw std::runtime_error(path.string() + " exists and is not a socket");
+            const int probe = unixSocket();
+            const bool live = ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+            const int why = errno;
+            ::close(probe);
+            if (live) throw std::runtime_error("a daemon is already listening on " + path.string());
+            if (why != ECONNREFUSED) throw std::runtime_error("could not probe " + path.string());
+            ::unlink(path.c_str());
+        }
+
+        // Bounds every read and write on fd, so a stalled peer cannot hold a worker
+        inline void socketTimeouts(const int fd, const std::chrono::milliseconds timeout) {
+            timeval tv{};
+            tv.tv_sec = static_cast<decltype(tv.tv_sec)>(timeout.count() / 1000);
+            tv.tv_usec = static_cast<decltype(tv.tv_usec)>(timeout.count() % 1000 * 1000);
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        }
+    }
+
+    // Listens on a UNIX socket and polls every idle connection; a request that arrives
+    // is read, run and answered on a worker of the pool, and its connection then goes
+    // back to the poll set. Workers are held per request, not per connection, so idle
+    // clients cost nothing but a descriptor, and all requests share one CodeCache.
+    // A request must arrive whole within `timeout`, a reply write stalls for at most as
+    // long, and a connection idle for longer is closed.
+    class Daemon {
+        using Clock = std::chrono::steady_clock;
+
+        std::filesystem::path socketPath;
+        int listenFd = -1;
+        int wake[2] = {-1, -1}; // workers hand connections back through this pipe
+        std::chrono::milliseconds timeout;
+        CodeCache cache;
+        std::atomic<bool> stopping{false};
+        std::mutex connectionsLock;
+        std::condition_variable settled;
+        ankerl::unordered_dense::set<int> connections; // every open one, idle or busy
+        std::vector<int> returning; // served, waiting to rejoin the poll set
+        size_t busy = 0;            // connections handed to the pool
+        // Member destructors run after ~Daemon's body has closed the descriptors, so that
+        // body first waits until no worker is busy; an idle worker touches none of them
+        conc::ThreadPool pool;
+
+        // One request/reply on fd; false when the connection should be closed. The
+        // whole request must arrive within `timeout`, and the payload buffer grows with
+        // the bytes received rather than with the size the header announces.
+        bool serveOne(const int fd) {
+            const auto deadline = Clock::now() + timeout;
+            RequestHeader req{};
+            if (!detail::readFull(fd, &req, sizeof(req), deadline)) return false;
+            if ((req.payload != static_cast<uint32_t>(Payload::Source) &&
+                 req.payload != static_cast<uint32_t>(Payload::Image)) || req.size > MaxPayload)
+                return false; // not our protocol
+            std::string payload;
+            for (size_t have = 0; have < req.size;) {
+                const size_t want = std::min<size_t>(req.size, std::max<size_t>(have * 2, 64 * 1024));
+                payload.resize(want);
+                if (!detail::readFull(fd, payload.data() + have, want - have, deadline)) return false;
+                have = want;
+            }
+
+            const auto reply = serveRequest(cache, static_cast<Payload>(req.payload), std::move(payload));
+            const ReplyHeader head{reply.ok ? 1u : 0u, reply.returnCode, reply.output.size()};
+            return detail::writeFull(fd, &head, sizeof(head)) &&
+                   detail::writeFull(fd, reply.output.data(), reply.output.size());
+        }
+
+        void dispatch(const int fd) {
+            const bool keep = serveOne(fd);
+            {
+                const std::lock_guard<std::mutex> guard(connectionsLock);
+                if (keep && !stopping.load(std::memory_order_relaxed)) {
+                    returning.push_back(fd);
+                    // before busy drops, so serve() cannot return and the pipe close under it
+                    const char byte = 0;
+                    [[maybe_unused]] const auto n = ::write(wake[1], &byte, 1); // full pipe: a wake-up is pending
+                } else {
+                    connections.erase(fd);
+                    ::close(fd);
+                }
+                --busy;
+                settled.notify_all();
+            }
+        }
+
+        // Shuts every connection down, waits for the busy ones' workers, closes them all
+        void hangUp() {
+            std::unique_lock<std::mutex> guard(connectionsLock);
+            for (const int fd : connections) ::shutdown(fd, SHUT_RDWR);
+            settled.wait(guard, [this] { return busy == 0; });
+            for (const int fd : connections) ::close(fd);
+            connections.clear();
+            returning.clear();
+        }
+
+        void closeConnection(const int fd) {
+            const std::lock_guard<std::mutex> guard(connectionsLock);
+            connections.erase(fd);
+            ::close(fd);
+        }
+
+    public:
+        static constexpr std::chrono::milliseconds DefaultTimeout{30000};
+
+        // Replaces a stale socket file at path; throws if anything else is there
+        explicit Daemon(std::filesystem::path path, const size_t threads = 0, const size_t cachedPrograms = 1024,
+                        const std::chrono::milliseconds timeout = DefaultTimeout)
+            : socketPath(std::move(path)), timeout(timeout), cache(cachedPrograms), pool(threads) {
+            const auto addr = detail::socketAddress(socketPath);
+            detail::removeStaleSocket(socketPath, addr);
+            if (::pipe(wake) != 0) throw std::runtime_error("pipe could not be created");
+            ::fcntl(wake[0], F_SETFL, O_NONBLOCK);
+            ::fcntl(wake[1], F_SETFL, O_NONBLOCK);
+            try {
+                listenFd = detail::unixSocket();
+            } catch (...) {
+                ::close(wake[0]);
+                ::close(wake[1]);
+                throw;
+            }
+            if (::bind(listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(listenFd, 128) != 0) {
+                ::close(listenFd);
+                ::close(wake[0]);
+                ::close(wake[1]);
+                throw std::runtime_error("could not listen on " + socketPath.string());
+            }
+        }
+        Daemon(const Daemon&) = delete;
+        Daemon& operator=(const Daemon&) = delete;
+        ~Daemon() {
+            stop();
+            hangUp();
+            ::close(listenFd);
+            ::close(wake[0]);
+            ::close(wake[1]);
+            ::unlink(socketPath.c_str());
+        }
+
+        // Accepts and dispatches until stop(); then hangs up every open connection and
+        // returns once their workers are idle
+        void serve() {
+            ankerl::unordered_dense::map<int, Clock::time_point> idle; // by last activity
+            std::vector<pollfd> waiting;
+            while (!stopping.load(std::memory_order_relaxed)) {
+                waiting.clear();
+                waiting.push_back({listenFd, POLLIN, 0});
+                waiting.push_back({wake[0], POLLIN, 0});
+                for (const auto& [fd, since] : idle) waiting.push_back({fd, POLLIN, 0});
+                // a timeout, so stop() needs nothing but the flag
+                if (::poll(waiting.data(), waiting.size(), 200) < 0) continue;
+                const auto now = Clock::now();
+
+                if (waiting[1].revents & POLLIN) {
+                    char drain[64];
+                    while (::read(wake[0], drain, sizeof(drain)) > 0) {}
+                    const std::lock_guard<std::mutex> guard(connectionsLock);
+                    for (const int fd : returning) idle.emplace(fd, now);
+                    returning.clear();
+                }
+                if (waiting[0].revents & POLLIN) {
+                    if (const int fd = ::accept(listenFd, nullptr, nullptr); fd >= 0) {
+                        detail::socketTimeouts(fd, timeout);
+                        {
+                            const std::lock_guard<std::mutex> guard(connectionsLock);
+                            connections.insert(fd);
+                        }
+                        idle.emplace(fd, now);
+                    }
+                }
+                for (size_t i = 2; i < waiting.size(); ++i) {
+                    const int fd = waiting[i].fd;
+                    if (waiting[i].revents & POLLIN) {
+                        idle.erase(fd);
+                        {
+                            const std::lock_guard<std::mutex> guard(connectionsLock);
+                            ++busy;
+                        }
+                        pool.submit([this, fd] { dispatch(fd); });
+                    } else if (waiting[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+                        idle.erase(fd);
+                        closeConnection(fd);
+                    }
+                }
+                for (auto it = idle.begin(); it != idle.end();) {
+                    if (now - it->second > timeout) {
+                        closeConnection(it->first);
+                        it = idle.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            hangUp();
+        }
+
+        // Async-signal-safe: only sets a flag
+        void stop() noexcept { stopping.store(true, std::memory_order_relaxed); }
+
+        [[nodiscard]] CodeCache& programs() noexcept { return cache; }
+        [[nodiscard]] const std::filesystem::path& path() const noexcept { return socketPath; }
+    };
+
+    // One connection to a Daemon; requests on it are answered in order
+    class DaemonClient {
+        int fd = -1;
+
+    public:
+        explicit DaemonClient(const std::filesystem::path& socketPath) {
+            const auto addr = detail::socketAddress(socketPath);
+            fd = detail::unixSocket();
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                throw std::runtime_error("could not connect to " + socketPath.string());
+            }
+        }
+        DaemonClient(const DaemonClient&) = delete;
+        DaemonClient& operator=(const DaemonClient&) = delete;
+        ~DaemonClient() { ::close(fd); }
+
+        DaemonReply run(const Payload kind, const std::string_view payload) {
+            const RequestHeader req{static_cast<uint32_t>(kind), 0, payload.size()};
+            if (!detail::writeFull(fd, &req, sizeof(req)) || !detail::writeFull(fd, payload.data(), payload.size()))
+                throw std::runtime_error("daemon connection lost");
+            ReplyHeader head{};
+            if (!detail::readFull(fd, &head, sizeof(head)) || head.size > MaxPayload)
+                throw std::runtime_error("daemon connection lost");
+            DaemonReply reply;
+            reply.ok = head.ok != 0;
+            reply.returnCode = head.returnCode;
+            reply.output.resize(head.size);
+            if (!detail::readFull(fd, reply.output.data(), reply.output.size()))
+                throw std::runtime_error("daemon connection lost");
+            return reply;
+        }
+    };
+#endif
+}
+
+#endif // CINDRA_DAEMON_H
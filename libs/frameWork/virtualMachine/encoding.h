@@ -0,0 +1,98 @@
+//
+// encoding.h - instruction encodings of CODE
+//
+#ifndef CINDRA_ENCODING_H
+#define CINDRA_ENCODING_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cid::code {
+    // Picked at codegen time; every consumer of CODE (verify, the runners, the
+    // threaded translation, the profiler) handles each of them.
+    // - Bytes: variable-length stream, [PRINT][type tag][4-byte operand] and
+    //   [RETURN][4-byte int]; operands sit at arbitrary byte offsets.
+    // - Words: 32-bit aligned words, the Op in the low 8 bits and the operand in the
+    //   high 24 (signed for ints, unsigned for pool indexes). An operand that does not
+    //   fit sets the Wide bit and follows in a second word. Decoding is a shift and a
+    //   mask, with no unaligned loads.
+    // - Varint: the Op in one byte followed by the operand as unsigned LEB128 (ints
+    //   zigzag-mapped first), the most compact layout for code that stays resident:
+    //   small ints and the first 128 pool entries take a single byte.
+    enum class Encoding : uint8_t { Bytes, Words, Varint };
+
+    // Decoded instruction kinds, and the opcode byte of the Words and Varint encodings
+    enum class Op : uint8_t { PrintInt = 1, PrintString, Return };
+
+    namespace word {
+        inline constexpr uint32_t Wide = 0x80;
+        inline constexpr int32_t MinNarrow = -(1 << 23);
+        inline constexpr int32_t MaxNarrow = (1 << 23) - 1;
+
+        [[nodiscard]] constexpr bool fitsInt(const int32_t v) { return v >= MinNarrow && v <= MaxNarrow; }
+        [[nodiscard]] constexpr bool fitsIndex(const uint32_t v) { return v < (1u << 24); }
+
+        [[nodiscard]] constexpr uint32_t make(const Op op, const uint32_t operand) {
+            return operand << 8 | static_cast<uint32_t>(op);
+        }
+        [[nodiscard]] constexpr uint32_t makeWide(const Op op) { return static_cast<uint32_t>(op) | Wide; }
+
+        [[nodiscard]] constexpr Op kind(const uint32_t w) { return static_cast<Op>(w & (Wide - 1)); }
+        [[nodiscard]] constexpr bool isWide(const uint32_t w) { return (w & Wide) != 0; }
+        // the arithmetic shift restores the sign of a narrow int
+        [[nodiscard]] constexpr int32_t intOperand(const uint32_t w) { return static_cast<int32_t>(w) >> 8; }
+        [[nodiscard]] constexpr uint32_t indexOperand(const uint32_t w) { return w >> 8; }
+    }
+
+    namespace varint {
+        inline constexpr size_t MaxBytes = 5; // 32 bits, 7 per byte
+
+        [[nodiscard]] constexpr uint32_t zigzag(const int32_t v) {
+            return static_cast<uint32_t>(v) << 1 ^ static_cast<uint32_t>(v >> 31);
+        }
+        [[nodiscard]] constexpr int32_t unzigzag(const uint32_t v) {
+            return static_cast<int32_t>(v >> 1 ^ (0u - (v & 1)));
+        }
+
+        inline void append(std::vector<uint8_t>& out, uint32_t v) {
+            while (v >= 0x80) {
+                out.push_back(static_cast<uint8_t>(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(v));
+        }
+
+        // Decodes one value of verified code and advances p; the single-byte case is
+        // one load and one compare
+        inline uint32_t read(const uint8_t*& p) {
+            uint32_t v = *p++;
+            if (__builtin_expect(v < 0x80, 1)) return v;
+            v &= 0x7F;
+            for (unsigned shift = 7;; shift += 7) {
+                const uint32_t b = *p++;
+                v |= (b & 0x7F) << shift;
+                if (b < 0x80) return v;
+            }
+        }
+
+        // Bounds-checked decode at code[i], advancing i only on success. Rejects values
+        // that run past the buffer or do not fit in 32 bits.
+        template<typename Bytes>
+        bool readSafe(const Bytes& code, size_t& i, uint32_t& v) {
+            uint32_t value = 0;
+            for (size_t n = 0; n < MaxBytes && i + n < code.size(); ++n) {
+                const uint32_t b = code[i + n];
+                if (n == MaxBytes - 1 && b > 0x0F) return false;
+                value |= (b & 0x7F) << (7 * n);
+                if (b < 0x80) {
+                    v = value;
+                    i += n + 1;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+}
+
+#endif // CINDRA_ENCODING_H
@@ -0,0 +1,159 @@
+//
+// output.h - buffered sinks for VM output
+//
+#ifndef CINDRA_OUTPUT_H
+#define CINDRA_OUTPUT_H
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CINDRA_HAS_WRITEV 1
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace cid::code {
+    // Destination of PRINT. Bytes collect in a user-space buffer and reach the backend
+    // only when it fills, on flush(), or when the VM returns; ints are formatted with
+    // std::to_chars straight into the buffer. Payloads larger than the buffer are
+    // handed to the backend together with the pending bytes, without a copy.
+    class OutputSink {
+        std::unique_ptr<char[]> buf;
+        size_t capacity;
+        size_t used = 0;
+
+    protected:
+        // Receives the pending bytes [a, a + an) followed by [b, b + bn) (bn may be 0)
+        virtual void drain(const char* a, size_t an, const char* b, size_t bn) = 0;
+
+    public:
+        explicit OutputSink(const size_t capacity = 64 * 1024)
+            : buf(new char[capacity < 64 ? 64 : capacity]), capacity(capacity < 64 ? 64 : capacity) {}
+        OutputSink(const OutputSink&) = delete;
+        OutputSink& operator=(const OutputSink&) = delete;
+        // Derived sinks flush in their own destructor, while drain() is still theirs
+        virtual ~OutputSink() = default;
+
+        void write(const char* p, const size_t n) {
+            if (n <= capacity - used) {
+                std::memcpy(buf.get() + used, p, n);
+                used += n;
+            } else if (n >= capacity) {
+                drain(buf.get(), used, p, n);
+                used = 0;
+            } else {
+                flush();
+                std::memcpy(buf.get(), p, n);
+                used = n;
+            }
+        }
+        void write(const std::string_view s) { write(s.data(), s.size()); }
+
+        template<typename Int>
+        void writeInt(const Int v) {
+            if (capacity - used < 24) flush(); // enough for any 64-bit value
+            used = static_cast<size_t>(std::to_chars(buf.get() + used, buf.get() + capacity, v).ptr - buf.get());
+        }
+
+        void flush() {
+            if (used == 0) return;
+            drain(buf.get(), used, nullptr, 0);
+            used = 0;
+        }
+    };
+
+    // Writes to a file descriptor (fd 1 by default) with write(2)/writev(2)
+    class FdSink final : public OutputSink {
+        int fd;
+
+    protected:
+        void drain(const char* a, size_t an, const char* b, size_t bn) override {
+#ifdef CINDRA_HAS_WRITEV
+            iovec parts[2] = {{const_cast<char*>(a), an}, {const_cast<char*>(b), bn}};
+            iovec* iov = an ? parts : parts + 1;
+            int count = (an ? 1 : 0) + (bn ? 1 : 0);
+            while (count > 0) {
+                const auto n = ::writev(fd, iov, count);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("output could not be written");
+                }
+                // partial write: skip what went out and retry the rest
+                auto done = static_cast<size_t>(n);
+                while (count > 0 && done >= iov->iov_len) {
+                    done -= iov->iov_len;
+                    ++iov;
+                    --count;
+                }
+                if (count > 0) {
+                    iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+                    iov->iov_len -= done;
+                }
+            }
+#else
+            FILE* f = fd == 2 ? stderr : stdout;
+            if (std::fwrite(a, 1, an, f) != an || std::fwrite(b, 1, bn, f) != bn || std::fflush(f) != 0)
+                throw std::runtime_error("output could not be written");
+#endif
+        }
+
+    public:
+        explicit FdSink(const int fd = 1, const size_t capacity = 64 * 1024)
+            : OutputSink(capacity), fd(fd) {}
+        ~FdSink() override {
+            try { flush(); } catch (...) {}
+        }
+    };
+
+    // Collects output in memory, for embedding and tests
+    class MemorySink final : public OutputSink {
+        std::string out;
+
+    protected:
+        void drain(const char* a, size_t an, const char* b, size_t bn) override {
+            out.append(a, an);
+            if (bn) out.append(b, bn);
+        }
+
+    public:
+        explicit MemorySink(const size_t capacity = 4 * 1024) : OutputSink(capacity) {}
+        ~MemorySink() override = default;
+
+        [[nodiscard]] const std::string& str() {
+            flush();
+            return out;
+        }
+        void clear() {
+            flush();
+            out.clear();
+        }
+    };
+
+    // Flushes a sink when the VM leaves a run, by return or by exception. Like
+    // std::cout, a failed final write is not reported.
+    class FlushOnExit {
+        OutputSink& sink;
+
+    public:
+        explicit FlushOnExit(OutputSink& sink) : sink(sink) {}
+        FlushOnExit(const FlushOnExit&) = delete;
+        FlushOnExit& operator=(const FlushOnExit&) = delete;
+        ~FlushOnExit() {
+            try { sink.flush(); } catch (...) {}
+        }
+    };
+
+    // Process-wide sink for fd 1; flushed by every run and at exit
+    inline FdSink& stdoutSink() {
+        static FdSink sink(1);
+        return sink;
+    }
+}
+
+#endif // CINDRA_OUTPUT_H
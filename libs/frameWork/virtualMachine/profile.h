@@ -0,0 +1,93 @@
+//
+// profile.h - opcode n-gram profile of a bytecode corpus
+//
+#ifndef CINDRA_PROFILE_H
+#define CINDRA_PROFILE_H
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "code.h"
+#include "../containers/unordered_dense_map.h"
+
+namespace cid::code {
+    // Counts every window of 1..MaxN consecutive instructions over the programs added.
+    // Instructions are keyed by opcode plus PRINT type tag, the granularity the fusion
+    // pass in ThreadedCode works at; the profile is what its rules are chosen from.
+    class OpcodeProfile {
+    public:
+        static constexpr size_t MaxN = 4;
+        enum Kind : uint8_t { PrintInt = 1, PrintString, Return };
+        static_assert(PrintInt == static_cast<int>(Op::PrintInt) && PrintString == static_cast<int>(Op::PrintString) &&
+                      Return == static_cast<int>(Op::Return), "Kind mirrors the decoded Op");
+
+    private:
+        // n kinds of 2 bits each, plus n in the top bits
+        ankerl::unordered_dense::map<uint32_t, uint64_t> counts;
+        uint64_t instructions = 0;
+
+        static uint32_t key(const Kind* window, const size_t n) {
+            uint32_t k = static_cast<uint32_t>(n) << 24;
+            for (size_t i = 0; i < n; ++i) k |= static_cast<uint32_t>(window[i]) << (2 * i);
+            return k;
+        }
+
+    public:
+        static const char* name(const Kind k) {
+            switch (k) {
+                case PrintInt: return "PRINT_INT";
+                case PrintString: return "PRINT_STRING";
+                case Return: return "RETURN";
+            }
+            return "?";
+        }
+
+        // Walks the instructions a run would execute: up to and including the first RETURN
+        void add(const CODE& src) {
+            if (!src.isVerified()) throw std::runtime_error("profiling requires verified bytecode");
+            std::array<Kind, MaxN> window{};
+            size_t filled = 0;
+            forEachInstruction(src, [&](const Op op, uint32_t) {
+                const auto kind = static_cast<Kind>(op);
+                if (filled == MaxN) {
+                    std::memmove(window.data(), window.data() + 1, (MaxN - 1) * sizeof(Kind));
+                    --filled;
+                }
+                window[filled++] = kind;
+                ++instructions;
+                // every n-gram ending at this instruction
+                for (size_t n = 1; n <= filled; ++n) ++counts[key(window.data() + filled - n, n)];
+            });
+        }
+
+        [[nodiscard]] uint64_t total() const noexcept { return instructions; }
+
+        // The `limit` most frequent n-grams of length n, as "OP OP ..." and count
+        [[nodiscard]] std::vector<std::pair<std::string, uint64_t>> top(const size_t n, const size_t limit) const {
+            std::vector<std::pair<uint32_t, uint64_t>> found;
+            for (const auto& [k, c] : counts) {
+                if ((k >> 24) == n) found.emplace_back(k, c);
+            }
+            std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+            if (found.size() > limit) found.resize(limit);
+
+            std::vector<std::pair<std::string, uint64_t>> out;
+            out.reserve(found.size());
+            for (const auto& [k, c] : found) {
+                std::string text;
+                for (size_t i = 0; i < n; ++i) {
+                    if (i) text += ' ';
+                    text += name(static_cast<Kind>((k >> (2 * i)) & 3u));
+                }
+                out.emplace_back(std::move(text), c);
+            }
+            return out;
+        }
+    };
+}
+
+#endif // CINDRA_PROFILE_H
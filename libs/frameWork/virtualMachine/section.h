@@ -0,0 +1,86 @@
+//
+// section.h - read-only arrays of CODE, owned or borrowed from a loaded image
+//
+#ifndef CINDRA_SECTION_H
+#define CINDRA_SECTION_H
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cid::code {
+    // Either owns its elements (generated code) or views memory kept alive by someone
+    // else (a mapped .cdb image), behind one data()/size() interface so readers need
+    // not care which. Owned sections can still grow, which is how the constant pool
+    // is built.
+    template<typename T>
+    class Section {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        std::vector<T> own;
+        const T* ptr = nullptr;
+        size_t count = 0;
+        bool borrowed = false;
+
+        void sync() noexcept {
+            ptr = own.data();
+            count = own.size();
+        }
+
+    public:
+        Section() = default;
+        explicit Section(std::vector<T>&& v) : own(std::move(v)) { sync(); }
+
+        // The caller keeps [p, p + n) alive for the life of the section and its copies
+        static Section borrow(const T* p, const size_t n) noexcept {
+            Section s;
+            s.ptr = p;
+            s.count = n;
+            s.borrowed = true;
+            return s;
+        }
+
+        Section(const Section& o) : own(o.own), ptr(o.ptr), count(o.count), borrowed(o.borrowed) {
+            if (!borrowed) sync();
+        }
+        Section(Section&& o) noexcept
+            : own(std::move(o.own)), ptr(o.ptr), count(o.count), borrowed(o.borrowed) {
+            o.ptr = nullptr;
+            o.count = 0;
+        }
+        Section& operator=(Section o) noexcept {
+            own.swap(o.own);
+            std::swap(ptr, o.ptr);
+            std::swap(count, o.count);
+            std::swap(borrowed, o.borrowed);
+            return *this;
+        }
+
+        // Growth is only for owned sections
+        void push_back(const T& v) {
+            own.push_back(v);
+            sync();
+        }
+        void append(const T* p, const size_t n) {
+            own.insert(own.end(), p, p + n);
+            sync();
+        }
+        void reserve(const size_t n) {
+            own.reserve(n);
+            sync();
+        }
+        void shrink_to_fit() {
+            own.shrink_to_fit();
+            if (!borrowed) sync();
+        }
+
+        [[nodiscard]] const T* data() const noexcept { return ptr; }
+        [[nodiscard]] size_t size() const noexcept { return count; }
+        [[nodiscard]] bool empty() const noexcept { return count == 0; }
+        [[nodiscard]] bool isBorrowed() const noexcept { return borrowed; }
+        [[nodiscard]] const T& operator[](const size_t i) const noexcept { return ptr[i]; }
+        [[nodiscard]] const T* begin() const noexcept { return ptr; }
+        [[nodiscard]] const T* end() const noexcept { return ptr + count; }
+    };
+}
+
+#endif // CINDRA_SECTION_H
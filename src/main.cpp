@@ -2,6 +2,12 @@
 // Created by dioguabo-rei-delas on 8/13/25.
 #include "../libs/frameWork/core.h"
 #include "../libs/frameWork/dynamicType/lazyAny.h"
+#include "../libs/frameWork/memory/trackNew.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 
 using namespace std;
 
@@ -9,13 +15,172 @@ struct fool {
     double i[128];
 };
 
+// `new_target --batch <manifest|directory> [threads] [--output-dir <dir>]`: compiles and
+// runs every script in this process and prints one tab-separated summary line per
+// script, in order: status, return code, output bytes, microseconds, path (and the
+// error, if any). Each line is followed by exactly that many bytes of the script's
+// output and a newline; with --output-dir the output goes to <dir>/<n>-<name>.out
+// instead, n being the script's position in the batch.
+static int batchMain(const char* source, const size_t threads, const char* outputDir) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto results = cid::code::runBatch(cid::code::batchScripts(source), threads);
+    const std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+
+    auto& out = cid::code::stdoutSink();
+    const cid::code::FlushOnExit flushed(out);
+    if (outputDir) std::filesystem::create_directories(outputDir);
+    size_t failed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out.write(r.ok ? "ok\t" : "error\t");
+        out.writeInt(r.returnCode);
+        out.write("\t");
+        out.writeInt(r.output.size());
+        out.write("\t");
+        out.writeInt(r.micros);
+        out.write("\t");
+        out.write(r.path.string());
+        if (!r.ok) {
+            out.write("\t");
+            out.write(r.error);
+            ++failed;
+        }
+        out.write("\n");
+        if (!outputDir) {
+            out.write(r.output);
+            out.write("\n");
+            continue;
+        }
+        const auto file = std::filesystem::path(outputDir) / (std::to_string(i) + "-" + r.path.filename().string() + ".out");
+        std::ofstream saved(file, std::ios::binary | std::ios::trunc);
+        if (!saved.write(r.output.data(), static_cast<std::streamsize>(r.output.size())) || !saved.flush())
+            throw std::runtime_error("could not write " + file.string());
+    }
+    out.write("# " + std::to_string(results.size()) + " scripts, " + std::to_string(failed) + " failed, " +
+              std::to_string(took.count()) + " ms\n");
+    return failed ? 1 : 0;
+}
+
+#ifdef CINDRA_HAS_UNIX_SOCKETS
+static cid::code::Daemon* runningDaemon = nullptr;
+
+// `new_target --serve <socket> [threads]`: compiles and runs requests until SIGINT/SIGTERM
+static int serveMain(const char* socket, const size_t threads) {
+    cid::code::Daemon daemon(socket, threads);
+    runningDaemon = &daemon;
+    auto onSignal = [](int) { runningDaemon->stop(); };
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    daemon.serve();
+    runningDaemon = nullptr;
+    return 0;
+}
+
+// `new_target --client <socket> <script>`: runs a script (or a .cdb image) on the daemon,
+// with the output and exit status of a direct run
+static int clientMain(const char* socket, const char* script) {
+    const auto kind = cid::help::isBytecodeFile(script) ? cid::code::Payload::Image : cid::code::Payload::Source;
+    const auto file = kind == cid::code::Payload::Image ? cid::help::SourceFile::map(script)
+                                                        : cid::help::openFile(script);
+    cid::code::DaemonClient client(socket);
+    const auto reply = client.run(kind, file.view());
+    if (!reply.ok) throw std::runtime_error(reply.output);
+    auto& out = cid::code::stdoutSink();
+    const cid::code::FlushOnExit flushed(out);
+    out.write(reply.output);
+    return reply.returnCode;
+}
+#endif
+
+// Removes `option value` from the command line; the value, or nullptr if absent
+static const char* takeOption(int& argc, const char** argv, const std::string_view option) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (option != argv[i]) continue;
+        const char* value = argv[i + 1];
+        for (int j = i; j + 2 <= argc; ++j) argv[j] = argv[j + 2];
+        argc -= 2;
+        return value;
+    }
+    return nullptr;
+}
+
+// Removes every occurrence of flag from the command line; true if there was one
+static bool takeFlag(int& argc, const char** argv, const std::string_view flag) {
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (flag != argv[i]) argv[kept++] = argv[i];
+    }
+    const bool found = kept != argc;
+    argc = kept;
+    argv[argc] = nullptr;
+    return found;
+}
+
 int main(int argc, const char** argv) {
+    // `--mem-stats` anywhere: allocation counters per subsystem on stderr at exit
+    // (counted only in a CINDRA_MEM_STATS build)
+    if (takeFlag(argc, argv, "--mem-stats")) {
+        std::atexit([] { cid::mem::printMemoryStats(stderr); });
+    }
+    if (argc > 2 && std::string_view(argv[1]) == "--batch") {
+        const char* outputDir = takeOption(argc, argv, "--output-dir");
+        return batchMain(argv[2], argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0, outputDir);
+    }
+#ifdef CINDRA_HAS_UNIX_SOCKETS
+    if (argc > 2 && std::string_view(argv[1]) == "--serve") {
+        return serveMain(argv[2], argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0);
+    }
+    if (argc > 3 && std::string_view(argv[1]) == "--client") {
+        return clientMain(argv[2], argv[3]);
+    }
+#endif
 
-    const auto buffer = cid::help::openFile(argc, argv);
-    const auto tokens = cid::tok::Tokenizer(buffer).tokenize();
-    const auto code = cid::code::unsafePrototypeCode(tokens);
-    //cid::tok::printToken(tokens);
-    return cid::code::unsafeRun(code);
+    auto code = [&] {
+        // precompiled images are mapped and run as they are
+        if (argc > 1 && cid::help::isBytecodeFile(argv[1])) {
+            return cid::code::loadCdb(argv[1]);
+        }
+
+        // stdin is streamed through a bounded window instead of being read whole
+        if (argc > 1 && std::string_view(argv[1]) == "-") {
+            const auto stream = cid::tok::TokenStream::open(argv[1]);
+            return cid::code::unsafePrototypeCode(*stream);
+        }
 
+        const auto buffer = cid::help::openFile(argc, argv);
 
+        // Debug mode: tokenize, validate and generate as separate passes
+        if (argc > 2 && std::string_view(argv[2]) == "--multi-pass") {
+            const auto tokens = cid::tok::tokenizeParallel(buffer.view());
+            //cid::tok::printToken(tokens);
+            std::string err;
+            if (!cid::par::validateProgram(tokens, &err)) throw std::runtime_error(err);
+            return cid::code::unsafePrototypeCode(tokens);
+        }
+
+        // With CINDRA_CACHE=1 or CINDRA_CACHE_DIR set, repeated runs of an unchanged script
+        // skip the front end: the cache is keyed by the source bytes and hands back
+        // verified code (see CompileCache::fromEnvironment for where it writes)
+        const auto cache = cid::code::CompileCache::fromEnvironment();
+        if (cache) {
+            if (auto hit = cache->lookup(buffer.view())) return std::move(*hit);
+        }
+        auto compiled = cid::code::compile(buffer.view());
+        if (cache) {
+            std::string err;
+            if (!cid::code::verify(compiled, &err)) throw std::runtime_error(err);
+            cache->store(buffer.view(), compiled);
+        }
+        return compiled;
+    }();
+
+    std::string err;
+    if (!code.isVerified() && !cid::code::verify(code, &err)) throw std::runtime_error(err);
+
+    // Compile only: `new_target script.cd --emit script.cdb` writes the image for later runs
+    if (argc > 3 && std::string_view(argv[2]) == "--emit") {
+        cid::code::writeCdb(code, argv[3]);
+        return 0;
+    }
+    return cid::code::unsafeRun(code);
 }